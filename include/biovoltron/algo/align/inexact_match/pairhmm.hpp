@@ -3,6 +3,10 @@
 #include <biovoltron/file_io/sam.hpp>
 #include <biovoltron/utility/haplotype/haplotype.hpp>
 #include <biovoltron/utility/read/quality_utils.hpp>
+#include <intel_native/pairhmm/avx-pairhmm.h>
+#include <intel_native/pairhmm/avx512-pairhmm.h>
+#include <numeric>
+#include <span>
 
 namespace biovoltron {
 
@@ -12,6 +16,14 @@ namespace biovoltron {
  * @brief TBA
  */
 struct PairHMM {
+  /**
+   * Kernel filling the DP matrices. SCALAR is the reference
+   * implementation below; AVX2 and AVX512 run the striped Intel kernels
+   * in single precision and redo a pair in double precision when its
+   * float result underflows.
+   */
+  enum class Backend { SCALAR, AVX2, AVX512 };
+
   enum {
     M_TO_M,
     M_TO_I,
@@ -34,49 +46,231 @@ struct PairHMM {
   static inline const auto INITIAL_CONDITION = std::pow(2, 1020);
   static inline const auto INITIAL_CONDITION_LOG10
     = std::log10(INITIAL_CONDITION);
+  // Phred-scaled gap penalties equivalent to ORIGINAL_DEFAULT.
+  static constexpr auto GAP_OPEN_QUAL = char{40};
+  static constexpr auto GAP_CONTINUATION_QUAL = char{10};
+
+  /**
+   * Whether the running CPU can execute backend.
+   */
+  static auto
+  is_supported(Backend backend) -> bool {
+    switch (backend) {
+      case Backend::AVX2:
+        return __builtin_cpu_supports("avx2");
+      case Backend::AVX512:
+        return __builtin_cpu_supports("avx512f")
+               && __builtin_cpu_supports("avx512dq")
+               && __builtin_cpu_supports("avx512bw")
+               && __builtin_cpu_supports("avx512vl");
+      default:
+        return true;
+    }
+  }
+
+  /**
+   * The widest backend supported by the running CPU.
+   */
+  static auto
+  fastest_backend() -> Backend {
+    for (const auto backend : {Backend::AVX512, Backend::AVX2})
+      if (is_supported(backend))
+        return backend;
+    return Backend::SCALAR;
+  }
+
+  Backend backend = fastest_backend();
+
+ private:
+  // Match and mismatch prior of each read base.
+  static auto
+  read_priors(const SamRecord<>& read) {
+    auto priors = std::vector<std::array<double, 2>>{};
+    priors.reserve(read.size());
+    for (const auto qual : read.qual) {
+      const auto error_prob = QualityUtils::qual_to_error_prob(qual);
+      priors.push_back({1 - error_prob, error_prob / TRISTATE_CORRECTION});
+    }
+    return priors;
+  }
+
+ public:
+  // Evaluation order of the haplotypes: grouped by length and sorted
+  // lexicographically, so neighbours share their longest prefixes.
+  // shared[k] is the number of leading haplotype columns the k-th
+  // haplotype takes over from an earlier one, and dependents[k] lists the
+  // later haplotypes resuming from a column the k-th one computes, by
+  // increasing column (all by position in order).
+  struct HaplotypeSchedule {
+    std::vector<std::size_t> order;
+    std::vector<std::size_t> shared;
+    std::vector<std::vector<std::size_t>> dependents;
+  };
+
+  static auto
+  schedule_haplotypes(const std::vector<Haplotype>& haplotypes) {
+    auto schedule = HaplotypeSchedule{};
+    auto& [order, shared, dependents] = schedule;
+    order.resize(haplotypes.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::ranges::sort(order, {}, [&](auto i) {
+      return std::pair{haplotypes[i].seq.size(),
+                       std::string_view{haplotypes[i].seq}};
+    });
+
+    shared.assign(order.size(), 0);
+    dependents.resize(order.size());
+    for (auto k = 1; k < order.size(); k++) {
+      const auto& prev = haplotypes[order[k - 1]].seq;
+      const auto& haplotype = haplotypes[order[k]].seq;
+      // The initial deletion row depends on the haplotype length.
+      if (prev.size() != haplotype.size())
+        continue;
+      shared[k] = std::ranges::mismatch(prev, haplotype).in1 - prev.begin();
+      if (shared[k] == 0)
+        continue;
+      // The latest haplotype that computes column shared[k] rather than
+      // taking it over; later ones in the group share a longer prefix.
+      auto source = k - 1;
+      while (shared[source] >= shared[k]) source--;
+      dependents[source].push_back(k);
+    }
+    // Later dependents share shorter prefixes.
+    for (auto& ks : dependents) std::ranges::reverse(ks);
+    return schedule;
+  }
+
+  // DP columns and prefix checkpoints of the scalar backend, kept between
+  // calls so that their memory is reused. Keep one per thread.
+  struct Workspace {
+    std::vector<double> columns;
+    std::vector<double> checkpoints;
+  };
 
  private:
+
+  // Fill the DP column by column over haplotype columns (begin, end],
+  // starting from column begin in prev and sum, the likelihood summed
+  // over the columns so far. prev and cur hold M, I and D of one column
+  // each, 3 * (read.size() + 1) doubles. on_column(j, column, sum) sees
+  // every column filled.
   auto
-  initialize_priors(SamRecord<>& read, std::string_view haplotype,
-                    auto& prior) const {
-    for (auto i = 0; i < read.size(); i++) {
-      const auto qual = read.qual[i];
-      const auto x = read.seq[i];
-      for (auto j = 0; j < haplotype.size(); j++) {
-        const auto y = haplotype[j];
-        prior[i + 1][j + 1]
-          = (x == y || x == 'N' || y == 'N' ?
-               1 - QualityUtils::qual_to_error_prob(qual) :
-               (QualityUtils::qual_to_error_prob(qual) / TRISTATE_CORRECTION));
+  fill_columns(const SamRecord<>& read,
+               std::span<const std::array<double, 2>> priors,
+               std::string_view haplotype, const TrasMatrx& trans,
+               std::size_t begin, std::size_t end, double* prev, double* cur,
+               double& sum, auto&& on_column) const {
+    const auto rows = read.size() + 1;
+    // Locals, since the columns could alias trans.
+    const auto [m_to_m, m_to_i, m_to_d, i_to_m, i_to_i, d_to_m, d_to_d] = trans;
+    const auto initial_value = INITIAL_CONDITION / haplotype.size();
+
+    for (auto j = begin + 1; j <= end; j++) {
+      const auto prev_M = prev, prev_I = prev + rows, prev_D = prev_I + rows;
+      const auto M = cur, I = cur + rows, D = I + rows;
+      const auto y = haplotype[j - 1];
+      M[0] = I[0] = 0.0;
+      D[0] = initial_value;
+      for (auto i = 1; i < rows; i++) {
+        const auto x = read.seq[i - 1];
+        const auto prior = x == y || x == 'N' || y == 'N' ? priors[i - 1][0]
+                                                          : priors[i - 1][1];
+        M[i] = prior
+               * (prev_M[i - 1] * m_to_m + prev_I[i - 1] * i_to_m
+                  + prev_D[i - 1] * d_to_m);
+        I[i] = M[i - 1] * m_to_i + I[i - 1] * i_to_i;
+        D[i] = prev_M[i] * m_to_d + prev_D[i] * d_to_d;
       }
+      sum += M[rows - 1] + I[rows - 1];
+      on_column(j, cur, sum);
+      std::swap(prev, cur);
     }
   }
 
+  // Likelihoods of read against every haplotype in schedule order. Each
+  // haplotype resumes from a checkpoint of the last column it shares
+  // with an earlier one instead of refilling the shared prefix.
   auto
-  sub_compute_likelihood(SamRecord<>& read, std::string_view haplotype,
-                         const TrasMatrx& trans, auto& M, auto& I, auto& D,
-                         auto& prior) const {
-    auto initial_value = INITIAL_CONDITION / haplotype.size();
-    for (auto j = 0; j <= haplotype.size(); j++) D[0][j] = initial_value;
-
-    initialize_priors(read, haplotype, prior);
-
-    for (auto i = 1; i <= read.size(); i++) {
-      for (auto j = 1; j <= haplotype.size(); j++) {
-        M[i][j]
-          = prior[i][j]
-            * (M[i - 1][j - 1] * trans[M_TO_M] + I[i - 1][j - 1] * trans[I_TO_M]
-               + D[i - 1][j - 1] * trans[D_TO_M]);
-        I[i][j] = M[i - 1][j] * trans[M_TO_I] + I[i - 1][j] * trans[I_TO_I];
-        D[i][j] = M[i][j - 1] * trans[M_TO_D] + D[i][j - 1] * trans[D_TO_D];
+  sub_compute_likelihoods(const SamRecord<>& read,
+                          const std::vector<Haplotype>& haplotypes,
+                          const HaplotypeSchedule& schedule,
+                          const TrasMatrx& trans, std::span<double> columns,
+                          std::span<double> checkpoints,
+                          std::span<double> log_likelihoods) const {
+    const auto& [order, shared, dependents] = schedule;
+    const auto priors = read_priors(read);
+    const auto column_size = 3 * (read.size() + 1);
+    const auto checkpoint_size = column_size + 1;
+    const auto prev = columns.data(), cur = prev + column_size;
+
+    for (auto k = 0; k < order.size(); k++) {
+      const auto& haplotype = haplotypes[order[k]].seq;
+      auto sum = 0.0;
+      if (shared[k] == 0) {
+        std::fill_n(prev, column_size, 0.0);
+        prev[2 * (read.size() + 1)] = INITIAL_CONDITION / haplotype.size();
+      } else {
+        const auto checkpoint = checkpoints.data() + k * checkpoint_size;
+        std::copy_n(checkpoint, column_size, prev);
+        sum = checkpoint[column_size];
       }
+
+      auto next = dependents[k].begin();
+      const auto save_checkpoints = [&](auto j, const double* column, auto sum) {
+        for (; next != dependents[k].end() && shared[*next] == j; next++) {
+          const auto checkpoint = checkpoints.data() + *next * checkpoint_size;
+          std::copy_n(column, column_size, checkpoint);
+          checkpoint[column_size] = sum;
+        }
+      };
+      fill_columns(read, priors, haplotype, trans, shared[k], haplotype.size(),
+                   prev, cur, sum, save_checkpoints);
+      log_likelihoods[order[k]] = std::log10(sum) - INITIAL_CONDITION_LOG10;
     }
+  }
+
+  template <typename FloatKernel, typename DoubleKernel>
+  static auto
+  simd_compute_likelihoods(const std::vector<Haplotype>& haplotypes,
+                           std::span<const SamRecord<>> reads,
+                           std::span<std::vector<double>> log_likelihoods,
+                           FloatKernel compute_float,
+                           DoubleKernel compute_double) {
+    // Fill the shared tables of the kernels once, before any thread reads them.
+    [[maybe_unused]] static const auto initialized = [] {
+      ConvertChar::init();
+      Context<float>{};
+      Context<double>{};
+      return true;
+    }();
+    const auto log10_initial_float = Context<float>::LOG10_INITIAL_CONSTANT;
+    const auto log10_initial_double = Context<double>::LOG10_INITIAL_CONSTANT;
 
-    auto final_sum_prob = 0.0;
-    const auto end_i = read.size();
-    for (auto j = 1; j <= haplotype.size(); j++)
-      final_sum_prob += M[end_i][j] + I[end_i][j];
-    return std::log10(final_sum_prob) - INITIAL_CONDITION_LOG10;
+    const auto flush_zero_mode = _MM_GET_FLUSH_ZERO_MODE();
+    _MM_SET_FLUSH_ZERO_MODE(_MM_FLUSH_ZERO_ON);
+    for (auto i = 0; i < reads.size(); i++) {
+      const auto& read = reads[i];
+      const auto gops = std::string(read.size(), GAP_OPEN_QUAL);
+      const auto gcps = std::string(read.size(), GAP_CONTINUATION_QUAL);
+      for (auto j = 0; j < haplotypes.size(); j++) {
+        auto tc = testcase{.rslen = static_cast<int>(read.size()),
+                           .haplen = static_cast<int>(haplotypes[j].seq.size()),
+                           // Base qualities index ph2pr as they index
+                           // qual_to_error_prob in read_priors.
+                           .q = read.qual.data(),
+                           .i = gops.data(),
+                           .d = gops.data(),
+                           .c = gcps.data(),
+                           .hap = haplotypes[j].seq.data(),
+                           .rs = read.seq.data()};
+        const auto result_float = compute_float(&tc);
+        log_likelihoods[i][j]
+          = result_float < MIN_ACCEPTED
+              ? std::log10(compute_double(&tc)) - log10_initial_double
+              : std::log10(result_float) - log10_initial_float;
+      }
+    }
+    _MM_SET_FLUSH_ZERO_MODE(flush_zero_mode);
   }
 
  public:
@@ -113,28 +307,75 @@ struct PairHMM {
     log_likelihoods.swap(filtered_likelihoods);
   }
 
+  /**
+   * Log10 likelihood of each read given each haplotype, computed with
+   * backend, before normalize_likelihoods and filter_poorly_modeled_reads.
+   * The SIMD kernels only model ORIGINAL_DEFAULT, so other transition
+   * matrices always use the scalar backend.
+   *
+   * @param schedule schedule_haplotypes(haplotypes), which the scalar
+   * backend follows.
+   * @param log_likelihoods One row per read, each of haplotypes.size().
+   * @param workspace Buffers of the scalar backend, reused from the
+   * previous call.
+   */
+  auto
+  compute_raw_likelihoods(const std::vector<Haplotype>& haplotypes,
+                          const HaplotypeSchedule& schedule,
+                          std::span<const SamRecord<>> reads,
+                          std::span<std::vector<double>> log_likelihoods,
+                          Workspace& workspace,
+                          const TrasMatrx& trans = ORIGINAL_DEFAULT) const
+    -> void {
+    if (reads.empty())
+      return;
+    if (backend != Backend::SCALAR && trans == ORIGINAL_DEFAULT) {
+      if (backend == Backend::AVX512)
+        simd_compute_likelihoods(haplotypes, reads, log_likelihoods,
+                                 compute_full_prob_avx512s<float>,
+                                 compute_full_prob_avx512d<double>);
+      else
+        simd_compute_likelihoods(haplotypes, reads, log_likelihoods,
+                                 compute_full_prob_avxs<float>,
+                                 compute_full_prob_avxd<double>);
+      return;
+    }
+
+    const auto column_size = 3 * (std::ranges::max(
+      reads, {}, [](const auto& read) { return read.size(); }).size() + 1);
+    auto& [columns, checkpoints] = workspace;
+    columns.resize(2 * column_size);
+    checkpoints.resize(haplotypes.size() * (column_size + 1));
+    for (auto i = 0; i < reads.size(); i++)
+      sub_compute_likelihoods(reads[i], haplotypes, schedule, trans, columns,
+                              checkpoints, log_likelihoods[i]);
+  }
+
+  /**
+   * Same as above with a schedule and a workspace of its own.
+   */
+  auto
+  compute_raw_likelihoods(const std::vector<Haplotype>& haplotypes,
+                          std::span<const SamRecord<>> reads,
+                          std::span<std::vector<double>> log_likelihoods,
+                          const TrasMatrx& trans = ORIGINAL_DEFAULT) const
+    -> void {
+    auto workspace = Workspace{};
+    compute_raw_likelihoods(haplotypes, schedule_haplotypes(haplotypes), reads,
+                            log_likelihoods, workspace, trans);
+  }
+
+  /**
+   * Log10 likelihood of each read given each haplotype, normalized, with
+   * the poorly modeled reads filtered out of reads.
+   */
   auto
   compute_likelihoods(const std::vector<Haplotype>& haplotypes,
                       std::vector<SamRecord<>>& reads,
                       const TrasMatrx& trans = ORIGINAL_DEFAULT) const {
-    auto get_padded_size = [](const auto& r) {
-      return 1 + std::ranges::max_element(r, {}, [](const auto& elem) {
-                   return elem.size();
-                 })->size();
-    };
-
-    auto M = std::vector(get_padded_size(reads),
-                         std::vector(get_padded_size(haplotypes), 0.0));
-    auto I = M;
-    auto D = M;
-    auto prior = M;
-
     auto log_likelihoods
       = std::vector(reads.size(), std::vector(haplotypes.size(), 0.0));
-    for (auto i = 0; i < reads.size(); i++)
-      for (auto j = 0; j < haplotypes.size(); j++)
-        log_likelihoods[i][j] = sub_compute_likelihood(
-          reads[i], haplotypes[j].seq, trans, M, I, D, prior);
+    compute_raw_likelihoods(haplotypes, reads, log_likelihoods, trans);
     normalize_likelihoods(log_likelihoods);
     filter_poorly_modeled_reads(reads, log_likelihoods);
     return log_likelihoods;
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <biovoltron/algo/align/inexact_match/pairhmm.hpp>
+#include <algorithm>
+
+namespace biovoltron {
+
+/**
+ * @ingroup align
+ *
+ * @brief Likelihood computations of many windows, run as one batch.
+ *
+ * Each job is one window's reads against its haplotypes. The jobs are
+ * split into one task per read, and schedule() orders all tasks by
+ * decreasing DP size, so workers claiming them in order finish the
+ * largest ones first. A window with many reads or long haplotypes is
+ * then spread over the workers instead of holding one of them while
+ * the others run out of work. A job's haplotype schedule is computed
+ * once, when it is pushed. The caller runs the tasks, possibly on
+ * several threads with a PairHMM::Workspace each, and takes each job's
+ * likelihoods back.
+ *
+ * The haplotypes and reads of a job must outlive the queue and stay
+ * in place until the job is taken.
+ */
+class PairHMMJobQueue {
+ public:
+  explicit PairHMMJobQueue(const PairHMM& pairhmm) : pairhmm(pairhmm) {}
+
+  /**
+   * Queue reads against haplotypes.
+   *
+   * @return Job id, to be passed to take.
+   */
+  auto
+  push(const std::vector<Haplotype>& haplotypes,
+       const std::vector<SamRecord<>>& reads) -> std::size_t {
+    auto haplotypes_size = std::size_t{};
+    for (const auto& haplotype : haplotypes)
+      haplotypes_size += haplotype.seq.size();
+
+    const auto job = jobs.size();
+    jobs.push_back({&haplotypes, &reads,
+                    PairHMM::schedule_haplotypes(haplotypes),
+                    std::vector(reads.size(),
+                                std::vector(haplotypes.size(), 0.0))});
+    for (auto read = std::size_t{}; read < reads.size(); read++)
+      tasks.push_back({job, read, reads[read].size() * haplotypes_size});
+    return job;
+  }
+
+  /**
+   * Order the tasks by decreasing cost.
+   *
+   * @return Number of tasks.
+   */
+  auto
+  schedule() {
+    std::ranges::stable_sort(tasks, std::ranges::greater{}, &Task::cost);
+    return tasks.size();
+  }
+
+  /**
+   * Run a task. Distinct tasks may run concurrently, each with a
+   * workspace of its own.
+   *
+   * @param workspace Buffers reused from the previous task.
+   */
+  auto
+  run(std::size_t task, PairHMM::Workspace& workspace) {
+    const auto [job, read, cost] = tasks[task];
+    auto& [haplotypes, reads, schedule, log_likelihoods] = jobs[job];
+    pairhmm.compute_raw_likelihoods(
+      *haplotypes, schedule, std::span{*reads}.subspan(read, 1),
+      std::span{log_likelihoods}.subspan(read, 1), workspace);
+  }
+
+  /**
+   * Likelihoods of a job once its tasks have run, as
+   * PairHMM::compute_likelihoods returns them: normalized, with the
+   * poorly modeled reads filtered out of reads.
+   *
+   * @param reads The reads of the job, or a copy of them.
+   */
+  auto
+  take(std::size_t job, std::vector<SamRecord<>>& reads) {
+    auto log_likelihoods = std::move(jobs[job].log_likelihoods);
+    PairHMM::normalize_likelihoods(log_likelihoods);
+    PairHMM::filter_poorly_modeled_reads(reads, log_likelihoods);
+    return log_likelihoods;
+  }
+
+ private:
+  struct Job {
+    const std::vector<Haplotype>* haplotypes;
+    const std::vector<SamRecord<>>* reads;
+    PairHMM::HaplotypeSchedule schedule;
+    std::vector<std::vector<double>> log_likelihoods;
+  };
+
+  struct Task {
+    std::size_t job;
+    std::size_t read;
+    std::size_t cost;
+  };
+
+  const PairHMM& pairhmm;
+  std::vector<Job> jobs;
+  std::vector<Task> tasks;
+};
+
+}  // namespace biovoltron
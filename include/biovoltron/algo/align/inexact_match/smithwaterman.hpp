@@ -43,6 +43,22 @@ struct SmithWaterman {
   /// Threshold for how many mismatches are allowed to be considered a "good match"
   static constexpr auto MAX_MISMATCHES = 2;
 
+  /**
+   * @brief Matrices and gap buffers of align, kept between calls so that
+   * their memory is reused. Keep one per thread.
+   *
+   * The score and trace matrices are stored row-major, one row per base
+   * of ref plus one, each row one column per base of alt plus one.
+   */
+  struct Workspace {
+    std::vector<int> score;
+    std::vector<int> trace;
+    std::vector<int> gap_size_down;
+    std::vector<int> best_gap_down;
+    std::vector<int> gap_size_right;
+    std::vector<int> best_gap_right;
+  };
+
   /**
    * @brief Quickly checks whether two strings differ by at most MAX_MISMATCHES.
    *
@@ -64,35 +80,36 @@ struct SmithWaterman {
    *
    * @param ref Reference sequence
    * @param alt Alternate sequence
-   * @param score Matrix to hold alignment scores
-   * @param trace Matrix to hold traceback directions
+   * @param workspace Holds the score and trace matrices to fill
    * @param params Alignment scoring parameters
    */
   static auto
   calculate_matrix(std::string_view ref, std::string_view alt,
-                   std::vector<std::vector<int>>& score,
-                   std::vector<std::vector<int>>& trace, Parameters params) {
-    const auto row_size = score.size();
-    const auto col_size = score[0].size();
+                   Workspace& workspace, Parameters params) {
+    const auto row_size = ref.size() + 1;
+    const auto col_size = alt.size() + 1;
+    auto& [score, trace, gap_size_down, best_gap_down, gap_size_right,
+           best_gap_right] = workspace;
+    score.assign(row_size * col_size, 0);
+    trace.assign(row_size * col_size, 0);
+    const auto at = [col_size](auto i, auto j) { return i * col_size + j; };
 
     // Gap tracking vectors for affine penalties
-    auto gap_size_down = std::vector(col_size + 1, 0);
-    auto best_gap_down
-      = std::vector(col_size + 1, std::numeric_limits<int>::min() / 2);
-    auto gap_size_right = std::vector(row_size + 1, 0);
-    auto best_gap_right
-      = std::vector(row_size + 1, std::numeric_limits<int>::min() / 2);
+    gap_size_down.assign(col_size + 1, 0);
+    best_gap_down.assign(col_size + 1, std::numeric_limits<int>::min() / 2);
+    gap_size_right.assign(row_size + 1, 0);
+    best_gap_right.assign(row_size + 1, std::numeric_limits<int>::min() / 2);
 
     const auto [w_match, w_mismatch, w_open, w_extend] = params;
     for (auto i = 1; i < row_size; i++) {
       for (auto j = 1; j < col_size; j++) {
         // Diagonal (match or mismatch)
         const auto step_diag
-          = score[i - 1][j - 1]
+          = score[at(i - 1, j - 1)]
             + (ref[i - 1] == alt[j - 1] ? w_match : w_mismatch);
 
         // Gap in ref (down)
-        const auto gap_open_down = score[i - 1][j] + w_open;
+        const auto gap_open_down = score[at(i - 1, j)] + w_open;
         best_gap_down[j] += w_extend;
         if (gap_open_down > best_gap_down[j]) {
           best_gap_down[j] = gap_open_down;
@@ -103,7 +120,7 @@ struct SmithWaterman {
         const auto step_down_size = gap_size_down[j];
 
         // Gap in alt (right)
-        const auto gap_open_right = score[i][j - 1] + w_open;
+        const auto gap_open_right = score[at(i, j - 1)] + w_open;
         best_gap_right[i] += w_extend;
         if (gap_open_right > best_gap_right[i]) {
           best_gap_right[i] = gap_open_right;
@@ -115,14 +132,14 @@ struct SmithWaterman {
 
         // Select the best move. The priority is diagonal > right > down.
         if (step_diag >= step_down && step_diag >= step_right) {
-          score[i][j] = step_diag;
-          trace[i][j] = 0;  // Diagonal move
+          score[at(i, j)] = step_diag;
+          trace[at(i, j)] = 0;  // Diagonal move
         } else if (step_right >= step_down) {
-          score[i][j] = step_right;
-          trace[i][j] = -step_right_size;  // Insertion
+          score[at(i, j)] = step_right;
+          trace[at(i, j)] = -step_right_size;  // Insertion
         } else {
-          score[i][j] = step_down;
-          trace[i][j] = step_down_size;  // Deletion
+          score[at(i, j)] = step_down;
+          trace[at(i, j)] = step_down_size;  // Deletion
         }
       }
     }
@@ -131,15 +148,19 @@ struct SmithWaterman {
   /**
    * @brief Performs traceback from the optimal cell to construct a CIGAR string.
    *
-   * @param score Filled scoring matrix
-   * @param trace Filled trace matrix
+   * @param ref_size Length of the reference sequence
+   * @param alt_size Length of the alternate sequence
+   * @param workspace Holds the filled score and trace matrices
    * @return A pair containing the alignment offset and resulting CIGAR object
    */
   static auto
-  calculate_cigar(std::vector<std::vector<int>>& score,
-                  std::vector<std::vector<int>>& trace) {
-    const auto ref_size = score.size() - 1;
-    const auto alt_size = score.front().size() - 1;
+  calculate_cigar(std::size_t ref_size, std::size_t alt_size,
+                  const Workspace& workspace) {
+    const auto& score = workspace.score;
+    const auto& trace = workspace.trace;
+    const auto at = [col_size = alt_size + 1](auto i, auto j) {
+      return i * col_size + j;
+    };
 
     auto max_score = std::numeric_limits<int>::min();
     auto segment_len = 0;
@@ -149,7 +170,7 @@ struct SmithWaterman {
     // one closer to diagonal gets picked
     auto pos_i = 0;
     for (auto i = 1; i <= ref_size; i++) {
-      const auto cur_score = score[i][alt_size];
+      const auto cur_score = score[at(i, alt_size)];
       if (cur_score >= max_score) {
         max_score = cur_score;
         pos_i = i;
@@ -160,7 +181,7 @@ struct SmithWaterman {
     auto pos_j = alt_size;
     auto diff = [](auto x, auto y) { return x > y ? x - y : y - x; };
     for (auto j = 1; j <= alt_size; j++) {
-      const auto cur_score = score[ref_size][j];
+      const auto cur_score = score[at(ref_size, j)];
       if (cur_score > max_score
           || (cur_score == max_score
               && diff(ref_size, j) < diff(pos_i, pos_j))) {
@@ -181,7 +202,7 @@ struct SmithWaterman {
 
     auto state = 'M';  // initial assumed state
     do {
-      const auto cur_trace = trace[pos_i][pos_j];
+      const auto cur_trace = trace[at(pos_i, pos_j)];
       const auto [new_state, step_size] = [cur_trace] {
         if (cur_trace > 0)
           return std::pair{'D', cur_trace};
@@ -237,21 +258,30 @@ struct SmithWaterman {
    *
    * @param ref Reference sequence.
    * @param alt Alternate (query) sequence.
+   * @param workspace Matrices reused from the previous call.
    * @param params Alignment parameters (optional).
    * @return Pair of alignment offset and CIGAR string.
    */
   static auto
-  align(std::string_view ref, std::string_view alt,
+  align(std::string_view ref, std::string_view alt, Workspace& workspace,
         Parameters params = NEW_SW_PARAMETERS) {
     assert(!ref.empty() && !alt.empty());
 
     if (alt.size() == ref.size() && well_match(ref, alt))
       return std::pair{0, Cigar(std::to_string(ref.size()) + 'M')};
 
-    auto score = std::vector(ref.size() + 1, std::vector(alt.size() + 1, 0));
-    auto trace = std::vector(ref.size() + 1, std::vector(alt.size() + 1, 0));
-    calculate_matrix(ref, alt, score, trace, params);
-    return calculate_cigar(score, trace);
+    calculate_matrix(ref, alt, workspace, params);
+    return calculate_cigar(ref.size(), alt.size(), workspace);
+  }
+
+  /**
+   * @brief Same as above with a workspace of its own.
+   */
+  static auto
+  align(std::string_view ref, std::string_view alt,
+        Parameters params = NEW_SW_PARAMETERS) {
+    auto workspace = Workspace{};
+    return align(ref, alt, workspace, params);
   }
 };
 
@@ -37,6 +37,9 @@ struct Alignment {
   std::uint32_t counts{};
   // head_pos is only used when extending toward the 5' end.
   std::uint32_t head_pos{};   // -1 for no head.
+  // Placeholder of a read too short to seed, with an 'N' or with too
+  // many hits. It carries no read name or quality.
+  bool fallback{};
 };
 
 // Note: If map to reverse strand:
@@ -4,6 +4,10 @@
 #include <biovoltron/file_io/fasta.hpp>
 #include <biovoltron/utility/istring.hpp>
 #include <biovoltron/utility/interval.hpp>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <optional>
 #include <vector>
 #include <random>
 
@@ -14,6 +18,8 @@
 
 namespace biovoltron {
 
+struct TailorIndexFile;
+
 /**
  * An FM-Index that report chromosome coordinate.
  */
@@ -36,7 +42,19 @@ struct Index : FMIndex<SA_INTV,size_type, Sorter> {
   using Base::lookup_;
   using Base::get_offsets;
 
-  Index(int lookup_len = 14) : FMIndex<SA_INTV, size_type, Sorter>{.LOOKUP_LEN = lookup_len} {}
+  /**
+   * Number of occurrences between two select samples.
+   */
+  constexpr static auto SELECT_INTV = size_type{64};
+
+  /**
+   * Whether make_index and load build the select samples.
+   */
+  bool with_select = true;
+
+  Index(int lookup_len = 14, bool with_select = true)
+    : FMIndex<SA_INTV, size_type, Sorter>{.LOOKUP_LEN = lookup_len},
+      with_select(with_select) {}
   
 
   /**
@@ -68,6 +86,62 @@ struct Index : FMIndex<SA_INTV,size_type, Sorter> {
         return c < 4 ? c : 0;
       });
     build(ref_seq);
+    if (with_select) build_select();
+  }
+
+  /**
+   * Sample the BWT position of every SELECT_INTV-th occurrence of each
+   * symbol, so that select() only scans the gap to the next occurrence.
+   * The primary index is not an occurrence, as in occ.
+   */
+  auto build_select() {
+    auto samples = std::array<std::vector<size_type>, 4>{};
+    auto counts = std::array<size_type, 4>{};
+    const auto words = (bwt_.size() + WORD_LEN - 1) / WORD_LEN;
+    for (auto w = size_type{}; w < words; w++) {
+      const auto word = get_bwt_word(w);
+      for (auto c = 0; c < 4; c++) {
+        auto mask = match_mask(word, c, w);
+        const auto pc = static_cast<size_type>(std::popcount(mask));
+        auto next = (counts[c] + SELECT_INTV - 1) / SELECT_INTV * SELECT_INTV;
+        for (; next < counts[c] + pc; next += SELECT_INTV)
+          samples[c].push_back(w * WORD_LEN + select_in_word(mask, next - counts[c]));
+        counts[c] += pc;
+      }
+    }
+    select_ = std::move(samples);
+  }
+
+  /**
+   * Whether the select samples are available.
+   */
+  auto has_select() const {
+    return select_.has_value();
+  }
+
+  /**
+   * BWT position of the k-th (0-based) occurrence of c, i.e. the
+   * position i with bwt[i] == c and occ(c, i) == k.
+   *
+   * @param c Symbol.
+   * @param k Rank of the occurrence, less than the occurrences of c.
+   * @return BWT position.
+   */
+  auto select(char_type c, size_type k) const {
+    assert(has_select());
+    const auto pos = (*select_)[c][k / SELECT_INTV];
+    auto rank = k % SELECT_INTV;
+    auto w = pos / WORD_LEN;
+    auto mask = match_mask(get_bwt_word(w), c, w)
+      & (~std::uint64_t{} << (pos % WORD_LEN * 2));
+    while (true) {
+      const auto pc = static_cast<size_type>(std::popcount(mask));
+      if (rank < pc)
+        return w * WORD_LEN + select_in_word(mask, rank);
+      rank -= pc;
+      w++;
+      mask = match_mask(get_bwt_word(w), c, w);
+    }
   }
 
   /**
@@ -150,6 +224,7 @@ struct Index : FMIndex<SA_INTV,size_type, Sorter> {
     auto ia = boost::archive::binary_iarchive{fin};
     ia >> chr_bounds;
     assert(fin.peek() == EOF);
+    if (with_select) build_select();
   }
 
   struct ChromBound {
@@ -166,6 +241,40 @@ struct Index : FMIndex<SA_INTV,size_type, Sorter> {
   };
 
   std::vector<ChromBound> chr_bounds{};
+
+ private:
+  friend struct TailorIndexFile;
+
+  // BWT symbols packed in a 64-bit word.
+  constexpr static auto WORD_LEN = size_type{32};
+
+  std::optional<std::array<std::vector<size_type>, 4>> select_;
+
+  auto get_bwt_word(size_type w) const {
+    const auto bytes = (bwt_.size() + 3) / 4;
+    auto word = std::uint64_t{};
+    std::memcpy(&word, bwt_.data() + w * 8, std::min<std::size_t>(8, bytes - w * 8));
+    return word;
+  }
+
+  // One bit (the low bit of each dibit) per occurrence of c in word w,
+  // ignoring the primary index and positions past the BWT.
+  auto match_mask(std::uint64_t word, char_type c, size_type w) const {
+    constexpr auto low_bits = std::uint64_t{0x5555555555555555};
+    const auto diff = word ^ (low_bits * c);
+    auto mask = ~(diff | diff >> 1) & low_bits;
+    const auto beg = w * WORD_LEN;
+    if (bwt_.size() - beg < WORD_LEN)
+      mask &= (std::uint64_t{1} << (bwt_.size() - beg) * 2) - 1;
+    if (c == 0 && beg <= pri_ && pri_ - beg < WORD_LEN)
+      mask &= ~(std::uint64_t{1} << (pri_ - beg) * 2);
+    return mask;
+  }
+
+  static auto select_in_word(std::uint64_t mask, size_type rank) {
+    for (; rank > 0; rank--) mask &= mask - 1;
+    return static_cast<size_type>(std::countr_zero(mask) / 2);
+  }
 };
 
 }  // namespace biovoltron
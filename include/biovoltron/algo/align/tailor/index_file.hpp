@@ -0,0 +1,451 @@
+#pragma once
+
+#include <biovoltron/algo/align/tailor/index.hpp>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace biovoltron {
+
+/**
+ * A versioned single-file container for the Tailor index pair (the
+ * index of the reference and of its reverse complement). Loading maps
+ * the file read-only and copies each section straight into the index
+ * vectors, without stream parsing or boost archives; the loaded indexes
+ * own their memory and do not keep the mapping.
+ *
+ * Layout, all integers in host byte order:
+ * - Header: magic, format version, SA_INTV, width of size_type,
+ *   lookup length, the scalar fields (cnt, pri, bwt size) of both
+ *   indexes and a checksum of the header and section table.
+ * - Section table: kind, owning index, offset, byte size, element count
+ *   and checksum of every section.
+ * - Sections, each starting at an ALIGNMENT-byte boundary: the raw
+ *   bwt, occ, sa, lookup (and sampled sa bit vectors if SA_INTV != 1)
+ *   of each index, then its contig table, contig names and, if built,
+ *   its select samples.
+ *
+ * Loading always checks magic, version, layout, bounds and the checksum
+ * of the header and section table. The section checksums read every
+ * byte of the index, so they are only checked when `verify` is set.
+ * Select samples missing from the file are rebuilt from the bwt.
+ *
+ * Example
+ * ```cpp
+ * #include <biovoltron/algo/align/tailor/index_file.hpp>
+ * #include <biovoltron/algo/align/tailor/tailor.hpp>
+ *
+ * using namespace biovoltron;
+ *
+ * int main() {
+ *   auto ref = std::vector<FastaRecord<>>{{"chr1", "CGATCGATCGATGCATCGATAGGG"}};
+ *   auto rc_ref = ref;
+ *   for (auto& record : rc_ref)
+ *     record.seq = Codec::rev_comp(record.seq);
+ *   auto index = Index{5};
+ *   index.make_index(ref);
+ *   auto rc_index = Index{5};
+ *   rc_index.make_index(rc_ref);
+ *   TailorIndexFile::save("ref.tidx", index, rc_index);
+ *
+ *   const auto [fmi, rc_fmi] = TailorIndexFile::load("ref.tidx");
+ *   auto tailor = Tailor{fmi, rc_fmi};
+ * }
+ * ```
+ */
+struct TailorIndexFile {
+  constexpr static auto MAGIC = std::array<char, 8>{'B', 'V', 'T', 'L', 'I', 'D', 'X', '\0'};
+  constexpr static auto VERSION = std::uint32_t{2};
+  constexpr static auto ALIGNMENT = std::uint64_t{64};
+
+  enum SectionKind : std::uint32_t {
+    BWT, OCC1, OCC2, SA, LOOKUP, SA_BITS, SA_BITS_OCC, CONTIGS, CONTIG_NAMES,
+    SELECT_A, SELECT_C, SELECT_G, SELECT_T
+  };
+
+  struct IndexInfo {
+    std::array<std::uint64_t, 4> cnt;
+    std::uint64_t pri;
+    std::uint64_t bwt_size;
+  };
+
+  struct Header {
+    std::array<char, 8> magic;
+    std::uint32_t version;
+    std::uint32_t sa_intv;
+    std::uint32_t size_type_bytes;
+    std::uint32_t lookup_len;
+    std::uint32_t section_count;
+    std::uint32_t reserved;
+    std::uint64_t file_bytes;
+    std::array<IndexInfo, 2> indexes;
+    std::uint64_t checksum;
+  };
+
+  struct Section {
+    std::uint32_t kind;
+    std::uint32_t index;
+    std::uint64_t offset;
+    std::uint64_t bytes;
+    std::uint64_t count;
+    std::uint64_t checksum;
+  };
+
+  struct Contig {
+    std::uint64_t name_offset;
+    std::uint32_t name_size;
+    std::uint32_t last_elem_pos;
+  };
+
+  /**
+   * 64-bit checksum over 8-byte words, fast enough to verify an index
+   * at memory bandwidth.
+   */
+  static auto checksum(std::span<const std::byte> bytes) {
+    constexpr auto prime = std::uint64_t{0x9e3779b97f4a7c15};
+    auto hash = std::uint64_t{0xcbf29ce484222325} ^ bytes.size();
+    auto i = std::size_t{};
+    for (; i + 8 <= bytes.size(); i += 8) {
+      auto word = std::uint64_t{};
+      std::memcpy(&word, bytes.data() + i, 8);
+      hash = std::rotl(hash ^ word, 31) * prime;
+    }
+    if (i < bytes.size()) {
+      auto word = std::uint64_t{};
+      std::memcpy(&word, bytes.data() + i, bytes.size() - i);
+      hash = std::rotl(hash ^ word, 31) * prime;
+    }
+    return hash ^ hash >> 29;
+  }
+
+  /**
+   * Checksum of a header, its own checksum field excluded, and of the
+   * section table.
+   */
+  static auto header_checksum(Header header, const std::vector<Section>& sections) {
+    header.checksum = 0;
+    const auto header_bytes = std::span{reinterpret_cast<const std::byte*>(&header), sizeof(header)};
+    return checksum(header_bytes) ^ std::rotl(checksum(std::as_bytes(std::span{sections})), 1);
+  }
+
+  /**
+   * Save an index pair into a single file.
+   *
+   * @param path Output file.
+   * @param fmi Index of the reference.
+   * @param rc_fmi Index of the reverse complemented reference.
+   * @throw std::runtime_error if the indexes differ in lookup length or
+   * the file cannot be written.
+   */
+  template<int SA_INTV, typename size_type, SASorter Sorter>
+  static auto save(
+    const std::filesystem::path& path,
+    const Index<SA_INTV, size_type, Sorter>& fmi,
+    const Index<SA_INTV, size_type, Sorter>& rc_fmi
+  ) {
+    if (fmi.LOOKUP_LEN != rc_fmi.LOOKUP_LEN)
+      throw std::runtime_error("Tailor indexes differ in lookup length.");
+
+    auto header = Header{};
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.sa_intv = SA_INTV;
+    header.size_type_bytes = sizeof(size_type);
+    header.lookup_len = fmi.LOOKUP_LEN;
+
+    // Contig tables are built first, since sections point into them.
+    std::array<std::vector<Contig>, 2> contigs;
+    std::array<std::string, 2> names;
+    auto payloads = std::vector<std::pair<Section, std::span<const std::byte>>>{};
+    for (auto which = 0u; which < 2; which++) {
+      const auto& index = which == 0 ? fmi : rc_fmi;
+      auto& info = header.indexes[which];
+      std::ranges::copy(index.cnt_, info.cnt.begin());
+      info.pri = index.pri_;
+      info.bwt_size = index.bwt_.size();
+
+      for (const auto& bound : index.chr_bounds) {
+        contigs[which].push_back(Contig{
+          names[which].size(),
+          static_cast<std::uint32_t>(bound.chrom.size()),
+          bound.last_elem_pos
+        });
+        names[which] += bound.chrom;
+      }
+
+      const auto add = [&](SectionKind kind, const auto& range) {
+        auto section = Section{};
+        section.kind = kind;
+        section.index = which;
+        section.count = range.size();
+        payloads.emplace_back(section, as_bytes(range));
+      };
+      add(BWT, index.bwt_);
+      add(OCC1, index.occ_.first);
+      add(OCC2, index.occ_.second);
+      add(SA, index.sa_);
+      add(LOOKUP, index.lookup_);
+      if constexpr (SA_INTV != 1) {
+        add(SA_BITS, index.b_);
+        add(SA_BITS_OCC, index.b_occ_);
+      }
+      add(CONTIGS, contigs[which]);
+      add(CONTIG_NAMES, names[which]);
+      if (index.has_select())
+        for (auto c = 0u; c < 4; c++)
+          add(static_cast<SectionKind>(SELECT_A + c), (*index.select_)[c]);
+    }
+
+    header.section_count = payloads.size();
+    auto offset = align(sizeof(Header) + payloads.size() * sizeof(Section));
+    auto sections = std::vector<Section>{};
+    for (auto& [section, bytes] : payloads) {
+      section.offset = offset;
+      section.bytes = bytes.size();
+      section.checksum = checksum(bytes);
+      sections.push_back(section);
+      offset = align(offset + bytes.size());
+    }
+    header.file_bytes = offset;
+    header.checksum = header_checksum(header, sections);
+
+    auto fout = std::ofstream{path, std::ios::binary};
+    fout.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    fout.write(reinterpret_cast<const char*>(sections.data()),
+               sections.size() * sizeof(Section));
+    auto written = sizeof(Header) + sections.size() * sizeof(Section);
+    for (const auto& [section, bytes] : payloads) {
+      pad(fout, section.offset - written);
+      fout.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+      written = section.offset + bytes.size();
+    }
+    pad(fout, header.file_bytes - written);
+    if (!fout)
+      throw std::runtime_error("An error occured when saving Tailor index to " + path.string());
+  }
+
+  /**
+   * Load an index pair saved by save().
+   *
+   * @tparam SA_INTV, size_type, Sorter Must match the saved indexes.
+   * @param path Input file.
+   * @param with_select Whether to load the select samples, building them
+   * if the file has none.
+   * @param verify Whether to also verify the section checksums.
+   * @return The index of the reference and of its reverse complement.
+   * @throw std::runtime_error if the file cannot be mapped, is not a
+   * Tailor index of this version and layout, or is corrupted.
+   */
+  template<
+    int SA_INTV = 1,
+    typename size_type = std::uint32_t,
+    SASorter Sorter = PsaisSorter<size_type>
+  >
+  static auto load(
+    const std::filesystem::path& path,
+    bool with_select = true,
+    bool verify = false
+  ) {
+    using index_type = Index<SA_INTV, size_type, Sorter>;
+    const auto file = MappedFile{path};
+    const auto bytes = file.bytes();
+    const auto fail = [&](const std::string& reason) {
+      return std::runtime_error("Invalid Tailor index " + path.string() + ": " + reason);
+    };
+
+    auto header = Header{};
+    if (bytes.size() < sizeof(Header))
+      throw fail("truncated header.");
+    std::memcpy(&header, bytes.data(), sizeof(Header));
+    if (header.magic != MAGIC)
+      throw fail("bad magic.");
+    if (header.version != VERSION)
+      throw fail("unsupported version " + std::to_string(header.version) + ".");
+    if (header.sa_intv != SA_INTV || header.size_type_bytes != sizeof(size_type))
+      throw fail("saved with a different SA_INTV or size_type.");
+    if (header.file_bytes != bytes.size())
+      throw fail("truncated file.");
+    const auto table_bytes = std::uint64_t{header.section_count} * sizeof(Section);
+    if (table_bytes > bytes.size() - sizeof(Header))
+      throw fail("truncated section table.");
+
+    auto sections = std::vector<Section>(header.section_count);
+    std::memcpy(sections.data(), bytes.data() + sizeof(Header), table_bytes);
+    if (header_checksum(header, sections) != header.checksum)
+      throw fail("header checksum mismatch.");
+
+    auto indexes = std::pair{
+      index_type{static_cast<int>(header.lookup_len), with_select},
+      index_type{static_cast<int>(header.lookup_len), with_select}
+    };
+    auto loaded = std::array<std::uint32_t, 2>{};
+    std::array<std::vector<Contig>, 2> contigs;
+    std::array<std::string, 2> names;
+    std::array<std::array<std::vector<size_type>, 4>, 2> selects;
+    for (const auto& section : sections) {
+      if (section.index > 1 || section.offset % ALIGNMENT != 0
+          || section.offset > bytes.size()
+          || section.bytes > bytes.size() - section.offset)
+        throw fail("section out of bounds.");
+      const auto payload = bytes.subspan(section.offset, section.bytes);
+      if (verify && checksum(payload) != section.checksum)
+        throw fail("section checksum mismatch.");
+
+      auto& index = section.index == 0 ? indexes.first : indexes.second;
+      const auto read = [&]<typename R>(R& range) {
+        if (storage_bytes<R>(section.count) != section.bytes)
+          throw fail("section size mismatch.");
+        range.resize(section.count);
+        const auto dest = as_writable_bytes(range);
+        std::memcpy(dest.data(), payload.data(), dest.size());
+      };
+      switch (section.kind) {
+        case BWT: read(index.bwt_); break;
+        case OCC1: read(index.occ_.first); break;
+        case OCC2: read(index.occ_.second); break;
+        case SA: read(index.sa_); break;
+        case LOOKUP: read(index.lookup_); break;
+        case SA_BITS: if constexpr (SA_INTV != 1) read(index.b_); break;
+        case SA_BITS_OCC: if constexpr (SA_INTV != 1) read(index.b_occ_); break;
+        case CONTIGS: read(contigs[section.index]); break;
+        case CONTIG_NAMES: read(names[section.index]); break;
+        case SELECT_A: case SELECT_C: case SELECT_G: case SELECT_T:
+          if (with_select) read(selects[section.index][section.kind - SELECT_A]);
+          break;
+        default:
+          throw fail("unknown section kind " + std::to_string(section.kind) + ".");
+      }
+      loaded[section.index] |= 1u << section.kind;
+    }
+
+    auto required = (1u << BWT) | (1u << OCC1) | (1u << OCC2) | (1u << SA)
+      | (1u << LOOKUP) | (1u << CONTIGS) | (1u << CONTIG_NAMES);
+    if constexpr (SA_INTV != 1)
+      required |= (1u << SA_BITS) | (1u << SA_BITS_OCC);
+    for (auto which = 0u; which < 2; which++) {
+      auto& index = which == 0 ? indexes.first : indexes.second;
+      const auto& info = header.indexes[which];
+      if ((loaded[which] & required) != required)
+        throw fail("missing sections.");
+      if (info.bwt_size != index.bwt_.size() || info.pri >= info.bwt_size)
+        throw fail("bwt size mismatch.");
+      std::ranges::copy(info.cnt, index.cnt_.begin());
+      index.pri_ = info.pri;
+      for (const auto& contig : contigs[which]) {
+        if (contig.name_offset > names[which].size()
+            || contig.name_size > names[which].size() - contig.name_offset)
+          throw fail("contig name out of bounds.");
+        index.chr_bounds.emplace_back(
+          names[which].substr(contig.name_offset, contig.name_size),
+          contig.last_elem_pos);
+      }
+      constexpr auto select_sections = (1u << SELECT_A) | (1u << SELECT_C)
+        | (1u << SELECT_G) | (1u << SELECT_T);
+      if (!with_select)
+        continue;
+      if ((loaded[which] & select_sections) == select_sections) {
+        for (const auto& samples : selects[which])
+          if (!samples.empty() && samples.back() >= info.bwt_size)
+            throw fail("select sample out of bounds.");
+        index.select_ = std::move(selects[which]);
+      } else
+        index.build_select();
+    }
+    return indexes;
+  }
+
+ private:
+  // Read-only mapping of a whole file.
+  struct MappedFile {
+    explicit MappedFile(const std::filesystem::path& path) {
+      const auto fd = ::open(path.c_str(), O_RDONLY);
+      if (fd < 0)
+        throw std::runtime_error("Cannot open Tailor index " + path.string() + ".");
+      struct stat st{};
+      if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+        size = st.st_size;
+        data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      }
+      ::close(fd);
+      if (data == MAP_FAILED)
+        throw std::runtime_error("Cannot mmap Tailor index " + path.string() + ".");
+      if (data != nullptr)
+        ::madvise(data, size, MADV_SEQUENTIAL);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile() {
+      if (data != nullptr && data != MAP_FAILED)
+        ::munmap(data, size);
+    }
+
+    auto bytes() const {
+      return std::span{static_cast<const std::byte*>(data), size};
+    }
+
+    void* data = nullptr;
+    std::size_t size{};
+  };
+
+  static auto align(std::uint64_t offset) {
+    return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+  }
+
+  static auto pad(std::ofstream& fout, std::uint64_t bytes) {
+    constexpr auto zeros = std::array<char, ALIGNMENT>{};
+    fout.write(zeros.data(), bytes);
+  }
+
+  // Raw storage of a contiguous range, packed vectors included.
+  template<typename R>
+  static auto storage(R& range) {
+    if constexpr (requires { range.num_blocks(); })
+      return std::span{range.data(), range.num_blocks()};
+    else
+      return std::span{range.data(), range.size()};
+  }
+
+  template<typename R>
+  static auto as_bytes(const R& range) {
+    return std::as_bytes(storage(range));
+  }
+
+  template<typename R>
+  static auto as_writable_bytes(R& range) {
+    return std::as_writable_bytes(storage(range));
+  }
+
+  // Bytes of raw storage of a range of count elements, saturated so that
+  // a count read from a corrupted file cannot overflow.
+  template<typename R>
+  static auto storage_bytes(std::uint64_t count) {
+    constexpr auto max = std::numeric_limits<std::uint64_t>::max();
+    if constexpr (requires { R::xbits_per_block; }) {
+      const auto blocks = count == 0 ? 0 : (count - 1) / R::xbits_per_block + 1;
+      constexpr auto block_bytes = sizeof(typename R::block_type);
+      return blocks > max / block_bytes ? max : blocks * block_bytes;
+    } else {
+      constexpr auto value_bytes = sizeof(typename R::value_type);
+      return count > max / value_bytes ? max : count * value_bytes;
+    }
+  }
+};
+
+}  // namespace biovoltron
@@ -4,8 +4,14 @@
 #include <biovoltron/algo/align/tailor/index.hpp>
 #include <biovoltron/file_io/fastq.hpp>
 #include <biovoltron/utility/istring.hpp>
+#include <biovoltron/utility/threadpool/parallel_for.hpp>
+#include <algorithm>
+#include <atomic>
 #include <ranges>
-#include <mutex>
+#include <span>
+#include <string_view>
+#include <thread>
+#include <tbb/concurrent_hash_map.h>
 
 namespace biovoltron {
 
@@ -42,6 +48,14 @@ namespace biovoltron {
  * for (const auto& read : sample1)
  *   alns.emplace_back(tailor.search(read));
  *
+ * // Or align the whole sample on 8 threads, results in input order.
+ * auto aln_pairs = tailor.search_batch(std::span{sample1}, 8);
+ *
+ * // Or align each distinct sequence once and fan the results out.
+ * auto collapsed = tailor.search_collapsed(std::span{sample1}, 8);
+ * auto collapse_ratio = collapsed.collapse_ratio();
+ * aln_pairs = collapsed.expand(std::span{sample1});
+ *
  * auto ofs = std::ofstream{"result.sam"};
  * for (const auto& aln : alns)
  *   for (const auto& record : aln_to_sam_list(aln))
@@ -62,6 +76,8 @@ struct Tailor {
   bool allow_seed_mismatch = false;
   bool strict_mode = false;
   bool enable_c2t = false;
+  // Most C positions c2t converts back to T in one read.
+  size_type max_c2t_conversions = 3;
   size_type seed_len = 18;
   size_type max_multi = 10;
   size_type max_5adapter_len = 0;
@@ -87,7 +103,6 @@ struct Tailor {
     }
   };
 
-  std::once_flag ranges_init_flag;
   std::array<range_type, 4> base_ranges_fwd, base_ranges_rev;
   std::array<std::array<range_type, 4>, 4> window_ranges_fwd, window_ranges_rev;
 
@@ -341,23 +356,74 @@ struct Tailor {
     return aln;
   }
 
+  // Conversion sets (C positions of the read, ascending) under which the
+  // read prefix still has a non-empty BWT range in fmi or rc_fmi. The
+  // search branches on C/T at every C inside the backward search, so a
+  // shared prefix is walked once, with at most `budget` conversions and,
+  // if allow_seed_mismatch, one free substitution.
+  auto c2t_prefix_sets(istring_view prefix, size_type budget) const {
+    auto sets = std::set<std::vector<size_type>>{};
+    auto conversions = std::vector<size_type>{};
+    auto walk = [&](
+      auto& self, const index_type& index,
+      size_type i, size_type beg, size_type end, bool substituted
+    ) -> void {
+      if (end <= beg) return;
+      if (i == prefix.size()) {
+        sets.insert(conversions);
+        return;
+      }
+      const auto base = prefix[i];
+      const auto convert = base == 1 && conversions.size() < budget;
+      if (convert) conversions.push_back(i);
+      // rc_read is searched from its back, i.e. complements in read order.
+      for (auto chr = convert ? 3 : base; ; chr = base) {
+        if (convert && chr == base) conversions.pop_back();
+        self(self, index, i + 1,
+             index.lf_mapping(3 - chr, beg), index.lf_mapping(3 - chr, end),
+             substituted);
+        if (allow_seed_mismatch && !substituted)
+          for (auto sub = 0; sub < 4; sub++)
+            if (sub != chr)
+              self(self, index, i + 1,
+                   index.lf_mapping(3 - sub, beg), index.lf_mapping(3 - sub, end),
+                   true);
+        if (chr == base) break;
+      }
+    };
+    for (const auto* index : {&fmi, &rc_fmi})
+      walk(walk, *index, 0, 0, index->get_bwt_size(), false);
+    return sets;
+  }
+
   template <bool Encoded>
   auto c2t (
     const FastqRecord<Encoded>& record, 
     std::vector<Raw>& candidates,
     size_type local_seed_len
   ) const {
-    // todo: Make combination cleaner and more expressive.
-    auto read = record.seq;
+    auto read = istring{};
+    if constexpr (Encoded) read = record.seq;
+    else read = Codec::to_istring(record.seq);
     auto pos = std::vector<size_type>{};
     for (auto i = 0; i < read.size(); i++)
-      if (read[i] == 'C')
+      if (read[i] == 1)
         pos.push_back(i);
-    // At most do 3-combination
-    for (auto i = 1; i <= 3 && i <= pos.size(); i++) {
-    
-    // exhausted all combination
-    // for (auto i = 1; i <= pos.size(); i++) {
+
+    // A search only reports candidates once its first local_seed_len + 1
+    // bases match (with one substitution if allow_seed_mismatch), so
+    // conversions are first checked on that prefix against the index.
+    const auto prefix_len = local_seed_len + 1;
+    if (prefix_len > read.size())
+      return;
+    const auto prefix_sets = c2t_prefix_sets(
+      istring_view{read}.substr(0, prefix_len), max_c2t_conversions);
+    if (prefix_sets.empty())
+      return;
+
+    // Same order as enumerating all combinations: fewest conversions
+    // first, then lexicographically by position.
+    for (auto i = 1; i <= max_c2t_conversions && i <= pos.size(); i++) {
       auto list = std::string(i, 1);
       list.resize(pos.size(), 0);
   
@@ -366,12 +432,17 @@ struct Tailor {
         for (auto j = 0; j < list.size(); j++)
           if (list[j] == 1)
             indexes.push_back(pos[j]);
+
+        auto in_prefix = indexes;
+        std::erase_if(in_prefix, [=](auto idx) { return idx >= prefix_len; });
+        if (!prefix_sets.contains(in_prefix))
+          continue;
   
         for (auto idx : indexes)
-          read[idx] = 'T';
-        auto rc_read = istring{};
-        if constexpr (Encoded) rc_read = Codec::rev_comp(read);
-        else rc_read = Codec::rev_comp(Codec::to_istring(read));
+          read[idx] = 3;
+        const auto rc_read = Codec::rev_comp(read);
+        for (auto idx : indexes)
+          read[idx] = 1;
 
         std::ranges::move(search_(rc_read, true, local_seed_len), std::back_inserter(candidates));
         std::ranges::move(search_(rc_read, false, local_seed_len), std::back_inserter(candidates));
@@ -382,16 +453,32 @@ struct Tailor {
           }
           return;
         }
-  
-        for (auto idx : indexes)
-          read[idx] = 'C';
       } while (std::ranges::prev_permutation(list).found);
     }
   }
 
-  // Use binary search to find the first index i in BWT[begin, end),
+  template <bool Encoded>
+  static auto seq_key(const FastqRecord<Encoded>& record) {
+    return std::string_view{
+      reinterpret_cast<const char*>(record.seq.data()), record.seq.size()};
+  }
+
+  struct SeqKeyCompare {
+    static auto hash(std::string_view key) {
+      return std::hash<std::string_view>{}(key);
+    }
+    static auto equal(std::string_view lhs, std::string_view rhs) {
+      return lhs == rhs;
+    }
+  };
+
+  // Find the first index i in BWT[begin, end),
   // where occ(base, i) == target, representing the index of the (order-th) occurrence of base.
+  // Uses the select samples of the index if built, binary search otherwise.
   inline auto bwt_lower_bound(const index_type& index, size_type begin, size_type end, int8_t base, size_type order) const {
+    if (index.has_select())
+      return static_cast<size_type>(
+        index.select(base, index.get_occ_value(base, begin) + order));
     auto low = begin, high = end;
     while (index.bwt_[low] != base || low == index.pri_) ++low;
     ++low, ++high;
@@ -411,6 +498,30 @@ struct Tailor {
     : fmi(std::move(index)), rc_fmi(std::move(rc_index)) {
     assert(fmi.get_bwt_size() != 0);
     assert(rc_fmi.get_bwt_size() != 0);
+    build_range_tables();
+  }
+
+  /**
+   * Precompute the BWT ranges of every 1-mer and 2-mer used by
+   * search_with_extend5. Called by the constructor; call it again after
+   * replacing fmi or rc_fmi.
+   */
+  auto build_range_tables() {
+    for (int i = 0; i < 4; ++i) {
+      auto [beg_fwd, end_fwd, len_fwd] = fmi.get_range(biovoltron::istring({i}));
+      base_ranges_fwd[i] = {beg_fwd, end_fwd};
+      auto [beg_rev, end_rev, len_rev] = rc_fmi.get_range(biovoltron::istring({i}));
+      base_ranges_rev[i] = {beg_rev, end_rev};
+    }
+    for (int i = 0; i < 4; ++i) {
+      for (int j = 0; j < 4; ++j) {
+        auto window = biovoltron::istring({i, j});
+        auto [beg_fwd, end_fwd, len_fwd] = fmi.get_range(window);
+        auto [beg_rev, end_rev, len_rev] = rc_fmi.get_range(window);
+        window_ranges_fwd[i][j] = {beg_fwd, end_fwd};
+        window_ranges_rev[i][j] = {beg_rev, end_rev};
+      }
+    }
   }
 
   template <bool Encoded>
@@ -419,8 +530,8 @@ struct Tailor {
 
     auto make_fallback_return = [](bool is_N){
       return std::make_pair(
-        Alignment{.seq = (is_N ? "N": "")},
-        Alignment{.seq = (is_N ? "N": "")}
+        Alignment{.seq = (is_N ? "N": ""), .fallback = true},
+        Alignment{.seq = (is_N ? "N": ""), .fallback = true}
       );
     };
 
@@ -482,8 +593,144 @@ struct Tailor {
     return std::make_pair(aln_forward, aln_reverse);
   }
 
+  /**
+   * Align a batch of reads with `threads` workers.
+   *
+   * Workers claim chunks of `chunk_size` reads from a shared cursor and
+   * write each result to the slot of its read, so the output is in input
+   * order. search only reads the indexes and keeps its buffers local, so
+   * no locking is needed.
+   *
+   * @return One search result per record.
+   */
+  template <bool Encoded>
+  auto search_batch(
+    std::span<const FastqRecord<Encoded>> records,
+    std::size_t threads = std::thread::hardware_concurrency(),
+    std::size_t chunk_size = 1024
+  ) const {
+    auto results = std::vector<std::pair<Alignment, Alignment>>(records.size());
+    parallel_for(records.size(), threads, chunk_size, [&](auto i) {
+      results[i] = search(records[i]);
+    });
+    return results;
+  }
+
+  template <bool Encoded>
+  auto search_batch(
+    const std::vector<FastqRecord<Encoded>>& records,
+    std::size_t threads = std::thread::hardware_concurrency(),
+    std::size_t chunk_size = 1024
+  ) const {
+    return search_batch(
+      std::span<const FastqRecord<Encoded>>{records}, threads, chunk_size);
+  }
+
+  /**
+   * Search results of the distinct sequences of a read batch.
+   */
+  struct Collapsed {
+    // Search result of each distinct sequence, named after its first read.
+    std::vector<std::pair<Alignment, Alignment>> alignments;
+    // Number of reads of each distinct sequence.
+    std::vector<std::uint32_t> counts;
+    // Index into alignments of each read.
+    std::vector<std::uint32_t> unique_ids;
+
+    // Reads per distinct sequence.
+    auto collapse_ratio() const {
+      return alignments.empty()
+        ? 1.0 : static_cast<double>(unique_ids.size()) / alignments.size();
+    }
+
+    // Per-read results, as search_batch(records) would return them.
+    template <bool Encoded>
+    auto expand(std::span<const FastqRecord<Encoded>> records) const {
+      assert(records.size() == unique_ids.size());
+      auto results = std::vector<std::pair<Alignment, Alignment>>{};
+      results.reserve(records.size());
+      for (auto i = 0; i < records.size(); i++) {
+        auto& [fwd, rev] = results.emplace_back(alignments[unique_ids[i]]);
+        for (auto* aln : {&fwd, &rev}) {
+          if (aln->fallback) continue;
+          aln->name = records[i].name;
+          aln->qual = records[i].qual;
+        }
+      }
+      return results;
+    }
+
+    template <bool Encoded>
+    auto expand(const std::vector<FastqRecord<Encoded>>& records) const {
+      return expand(std::span<const FastqRecord<Encoded>>{records});
+    }
+  };
+
+  /**
+   * Collapse identical read sequences and search each distinct one once.
+   *
+   * Sequences are counted in a concurrent hash map keyed by views into
+   * `records`. Distinct sequences are ordered by their first read, so the
+   * result does not depend on the thread count.
+   */
+  template <bool Encoded>
+  auto search_collapsed(
+    std::span<const FastqRecord<Encoded>> records,
+    std::size_t threads = std::thread::hardware_concurrency(),
+    std::size_t chunk_size = 1024
+  ) const {
+    // Value: (first read, read count), then (unique id, read count).
+    using map_type = tbb::concurrent_hash_map<
+      std::string_view, std::pair<std::uint32_t, std::uint32_t>, SeqKeyCompare>;
+    auto seqs = map_type{};
+    parallel_for(records.size(), threads, chunk_size, [&](auto i) {
+      auto acc = typename map_type::accessor{};
+      if (seqs.insert(acc, seq_key(records[i])))
+        acc->second = {i, 1};
+      else
+        acc->second = {std::min<std::uint32_t>(acc->second.first, i),
+                       acc->second.second + 1};
+    });
+
+    auto firsts = std::vector<std::pair<std::uint32_t, std::uint32_t>>{};
+    firsts.reserve(seqs.size());
+    for (const auto& [seq, value] : seqs) firsts.push_back(value);
+    std::ranges::sort(firsts);
+
+    auto collapsed = Collapsed{};
+    collapsed.alignments.resize(firsts.size());
+    collapsed.counts.reserve(firsts.size());
+    for (auto id = 0u; const auto& [first, count] : firsts) {
+      auto acc = typename map_type::accessor{};
+      seqs.find(acc, seq_key(records[first]));
+      acc->second.first = id++;
+      collapsed.counts.push_back(count);
+    }
+
+    collapsed.unique_ids.resize(records.size());
+    parallel_for(records.size(), threads, chunk_size, [&](auto i) {
+      auto acc = typename map_type::const_accessor{};
+      seqs.find(acc, seq_key(records[i]));
+      collapsed.unique_ids[i] = acc->second.first;
+    });
+    parallel_for(firsts.size(), threads, 1, [&](auto id) {
+      collapsed.alignments[id] = search(records[firsts[id].first]);
+    });
+    return collapsed;
+  }
+
+  template <bool Encoded>
+  auto search_collapsed(
+    const std::vector<FastqRecord<Encoded>>& records,
+    std::size_t threads = std::thread::hardware_concurrency(),
+    std::size_t chunk_size = 1024
+  ) const {
+    return search_collapsed(
+      std::span<const FastqRecord<Encoded>>{records}, threads, chunk_size);
+  }
+
   template <bool Encoded>
-  auto search_with_extend5(FastqRecord<Encoded>& record) {
+  auto search_with_extend5(const FastqRecord<Encoded>& record) const {
     auto skipped_seq = record.seq.substr(0, max_5adapter_len);
     auto skipped_qual = record.qual.substr(0, max_5adapter_len);
 
@@ -501,24 +748,6 @@ struct Tailor {
       return alignment;
     }
 
-    std::call_once(ranges_init_flag, [&]() {
-      for (int i = 0; i < 4; ++i) {
-        auto [beg_fwd, end_fwd, len_fwd] = fmi.get_range(biovoltron::istring({i}));
-        base_ranges_fwd[i] = {beg_fwd, end_fwd};
-        auto [beg_rev, end_rev, len_rev] = rc_fmi.get_range(biovoltron::istring({i}));
-        base_ranges_rev[i] = {beg_rev, end_rev};
-      }
-      for (int i = 0; i < 4; ++i) {
-        for (int j = 0; j < 4; ++j) {
-          auto window = biovoltron::istring({i, j});
-          auto [beg_fwd, end_fwd, len_fwd] = fmi.get_range(window);
-          auto [beg_rev, end_rev, len_rev] = rc_fmi.get_range(window);
-          window_ranges_fwd[i][j] = {beg_fwd, end_fwd};
-          window_ranges_rev[i][j] = {beg_rev, end_rev};
-        }
-      }
-    });
-    
     const auto &index = hit_in_first ? rc_fmi : fmi;
     const auto &base_ranges = hit_in_first ? base_ranges_rev : base_ranges_fwd;
     const auto &window_ranges = hit_in_first ? window_ranges_rev : window_ranges_fwd;
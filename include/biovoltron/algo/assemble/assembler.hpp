@@ -8,28 +8,41 @@
 #include <biovoltron/utility/haplotype/haplotype.hpp>
 #include <biovoltron/algo/assemble/graph/adapter_graph.hpp>
 #include <biovoltron/algo/assemble/graph/haplotype_graph.hpp>
+#include <biovoltron/utility/threadpool/parallel_for.hpp>
 
 namespace biovoltron {
 
 class Assembler {};
 
 class HaplotypeAssembler : Assembler {
+public:
+  /**
+   * @brief Graphs of assemble, kept between calls so that their memory is
+   * reused. Keep one per thread.
+   */
+  struct Workspace {
+    std::vector<HaplotypeGraph> graphs;
+    std::vector<char> usable;
+  };
+
 private:
+  static constexpr auto INITIAL_KMER_SIZE = 25;
+  static constexpr auto KMER_SIZE_ITERATION_INCREASE = 10;
+  static constexpr auto MAX_ITERATIONS_TO_ATTEMPT = 6;
+
   template<std::derived_from<Record> R, class RefType>
-    requires std::same_as<
-      RefType, std::conditional_t<R::encoded, istring_view, std::string_view>
-    >
-  auto assemble(const std::vector<R> reads,
-                RefType ref,
-                std::size_t kmer_size) const -> std::vector<Haplotype> {
+  auto build_graph(HaplotypeGraph& graph,
+                   const std::vector<R>& reads,
+                   RefType ref,
+                   std::size_t kmer_size) const -> bool {
     
     static constexpr auto MIN_UNIQUE_KMERS_COUNT_TO_DISCARD = 4096;
 
     if (ref.size() < kmer_size) {
-      return {};
+      return false;
     }
 
-    auto graph = HaplotypeGraph(kmer_size);
+    graph.reset(kmer_size);
     graph.set_ref(ref);
     for (const auto& read : reads) {
       graph.set_read(read);
@@ -39,39 +52,77 @@ private:
 
     if (graph.unique_kmers_count() > MIN_UNIQUE_KMERS_COUNT_TO_DISCARD) {
       SPDLOG_DEBUG("Not using kmer size of {} in assembler because it contains too much unique kmers", kmer_size);
-      return {};
+      return false;
     }
 
     if (graph.has_cycles()) {
       SPDLOG_DEBUG("Not using kmer size of {} in assembler because it contains a cycle", kmer_size);
-      return {};
+      return false;
     }
 
-    SPDLOG_DEBUG("Using kmer size of {} in assembler", kmer_size);
-    return graph.find_paths();
+    return true;
   }
 
 public:
+  /**
+   * @brief Assemble haplotypes with the smallest kmer size whose graph is
+   * acyclic, trying kmer sizes 25, 35, ... in turn.
+   * @param workspace Graphs reused from the previous call.
+   * @param haplotypes The haplotypes, or none if no kmer size is usable. The
+   * strings of the haplotypes already in it are reused.
+   * @param threads Number of kmer sizes tried at once, each on its own
+   * thread. The smallest usable one wins, so the result does not depend on
+   * it.
+   */
   template<std::derived_from<Record> R, class RefType>
     requires std::same_as<
       RefType, std::conditional_t<R::encoded, istring_view, std::string_view>
     >
-  auto assemble(const std::vector<R>& seqs, RefType ref) const {
-    static constexpr auto INITIAL_KMER_SIZE = 25;
-    static constexpr auto KMER_SIZE_ITERATION_INCREASE = 10;
-    static constexpr auto MAX_ITERATIONS_TO_ATTEMPT = 6;
-
-    auto iter = 1;
-    auto kmer_size = INITIAL_KMER_SIZE;
-    while (iter < MAX_ITERATIONS_TO_ATTEMPT) {
-      auto haplotypes = assemble(seqs, ref, kmer_size);
-      if (!haplotypes.empty()) {
-        return haplotypes;
+  auto assemble(const std::vector<R>& seqs, RefType ref, Workspace& workspace,
+                std::vector<Haplotype>& haplotypes,
+                std::size_t threads = 1) const -> void {
+    static constexpr auto attempts = MAX_ITERATIONS_TO_ATTEMPT - 1;
+
+    threads = std::clamp<std::size_t>(threads, 1, attempts);
+    auto& [graphs, usable] = workspace;
+    while (graphs.size() < threads) {
+      graphs.emplace_back(INITIAL_KMER_SIZE);
+    }
+    usable.resize(threads);
+    for (auto first = std::size_t{}; first < attempts; first += threads) {
+      const auto last = std::min<std::size_t>(first + threads, attempts);
+      parallel_for(last - first, threads, 1, [&](std::size_t i) {
+        usable[i] = build_graph(
+          graphs[i], seqs, ref,
+          INITIAL_KMER_SIZE + (first + i) * KMER_SIZE_ITERATION_INCREASE);
+      });
+
+      for (auto iter = first; iter < last; iter++) {
+        if (usable[iter - first]) {
+          SPDLOG_DEBUG("Using kmer size of {} in assembler",
+                       INITIAL_KMER_SIZE + iter * KMER_SIZE_ITERATION_INCREASE);
+          graphs[iter - first].find_paths(haplotypes);
+          return;
+        }
       }
-      iter++;
-      kmer_size += KMER_SIZE_ITERATION_INCREASE;
     }
-    return std::vector<Haplotype>{};
+    haplotypes.clear();
+  }
+
+  /**
+   * @brief Same as above with a workspace of its own.
+   * @return The haplotypes, or none if no kmer size is usable.
+   */
+  template<std::derived_from<Record> R, class RefType>
+    requires std::same_as<
+      RefType, std::conditional_t<R::encoded, istring_view, std::string_view>
+    >
+  auto assemble(const std::vector<R>& seqs, RefType ref,
+                std::size_t threads = 1) const {
+    auto workspace = Workspace{};
+    auto haplotypes = std::vector<Haplotype>{};
+    assemble(seqs, ref, workspace, haplotypes, threads);
+    return haplotypes;
   }
 };
 
@@ -1,15 +1,13 @@
 #pragma once
 
-#include <set>
-#include <map>
-#include <numeric>
+#include <bit>
+#include <span>
 
 #include <spdlog/spdlog.h>
 
 #include <biovoltron/file_io/sam.hpp>
 #include <biovoltron/utility/haplotype/haplotype.hpp>
 #include <biovoltron/utility/read/quality_utils.hpp>
-#include <biovoltron/algo/assemble/graph/graph_wrapper.hpp>
 #include <biovoltron/algo/align/inexact_match/smithwaterman.hpp>
 
 namespace biovoltron {
@@ -22,188 +20,295 @@ struct HaplotypeGraph {
   } para;
 
 private:
+  using Vertex = std::uint32_t;
+  using Edge = std::uint32_t;
+
+  constexpr static auto NONE = std::numeric_limits<std::uint32_t>::max();
+
+  /* out edges of a vertex are linked through next, in insertion order */
   struct VertexProperty {
     std::string_view kmer;
+    Edge first_out;
+    Edge last_out;
+    std::uint32_t out_degree;
   };
 
   struct EdgeProperty {
-    int count = 0;
-    bool is_ref = false;
-    bool is_on_path = false;
-    double score = std::numeric_limits<double>::lowest();
+    Vertex source;
+    Vertex target;
+    Edge next;
+    int count;
+    bool is_ref;
+    bool is_on_path;
+    double score;
   };
 
-  using Graph = GraphWrapper<VertexProperty, EdgeProperty>;
-  using Vertex = Graph::Vertex;
-  using Edge = Graph::Edge;
-  using Path = std::vector<Vertex>;
-
-  
-  struct cycle_detector : public boost::dfs_visitor<> {
-    cycle_detector(bool& has_cycle) : _has_cycle(has_cycle) {}
-    template <class Edge, class Graph>
-      void back_edge(Edge, Graph&) {
-        _has_cycle = true;
-      }
-    protected:
-    bool& _has_cycle;
+  /* distinct kmer of the ref and read segments, with the last sequence it was
+   * seen in, so a second occurrence in that sequence marks it duplicated */
+  struct Entry {
+    Vertex vertex;
+    std::uint32_t seq;
+    bool dup;
   };
 
-  struct EdgeFilter {
-    bool operator()(Edge e) const
-    { return (*g)[e].is_ref || (*g)[e].count >= para->PRUNE_FACTOR || g->out_degree(g->source(e)) == 1; }
-    Graph* g;
-    const Parameter* para;
-  } filter{&g, &para};
-
-  Graph g;
+  std::vector<VertexProperty> nodes;
+  std::vector<EdgeProperty> edges;
   Vertex source{}, sink{};
-  std::vector<Path> paths;
-  std::set<Vertex> vertices_on_paths;
+
+  /* all paths, as edges, back to back */
+  std::vector<Edge> path_edges;
+  std::vector<std::size_t> path_ends;
 
   std::string_view ref;
   std::vector<std::string_view> read_segs;
 
   std::size_t kmer_size;
-  std::set<std::string_view> dup_kmers;
-  std::map<std::string_view, Vertex> unique_kmers;
-
-  auto create_edge(Vertex u, Vertex v, bool is_ref) {
-    const auto e = g.create_edge(u, v);
-    g[e].count += 1;
-    g[e].is_ref = is_ref;
+  std::size_t key_words;
+  std::size_t unique_vertices = 0;
+
+  /* open addressing table of 2-bit packed kmers, key_words words per entry */
+  std::vector<Entry> entries;
+  std::vector<std::uint64_t> keys;
+  std::vector<std::uint32_t> slots;
+  /* kmers with bases other than ACGT cannot be packed, and are hashed as
+   * strings in a table of their own */
+  std::vector<std::string_view> unpacked_kmers;
+  std::vector<std::uint32_t> unpacked_entries;
+  std::vector<std::uint32_t> unpacked_slots;
+  /* entry of each kmer of the ref and read segments, in insertion order */
+  std::vector<std::uint32_t> kmer_entries;
+
+  /* scratch of the graph walks, kept to reuse its memory */
+  std::vector<std::uint64_t> key;
+  std::vector<std::uint32_t> marks;
+  std::vector<std::uint32_t> stack;
+  std::vector<Edge> path;
+  std::vector<double> sums;
+
+  /* matrices of the haplotype alignments to the ref */
+  SmithWaterman::Workspace sw_workspace;
+
+  static auto encode(char base) -> int {
+    switch (base) {
+      case 'A': return 0;
+      case 'C': return 1;
+      case 'G': return 2;
+      case 'T': return 3;
+      default: return -1;
+    }
   }
 
-  auto create_vertex(std::string_view kmer) {
-    const auto v = g.create_vertex();
-    g[v].kmer = kmer;
-    if (dup_kmers.find(kmer) == dup_kmers.end()) {
-      unique_kmers.emplace(kmer, v);
+  static auto hash(std::span<const std::uint64_t> key) {
+    auto h = std::uint64_t{};
+    for (const auto word : key) {
+      h = (h ^ word) * 0x9e3779b97f4a7c15ull;
+      h ^= h >> 29;
     }
-    return v;
+    return h;
   }
 
-  auto get_vertex(std::string_view kmer) {
-    if (auto it = unique_kmers.find(kmer); it != unique_kmers.end()) {
-      return it->second;
+  auto find_entry(std::span<const std::uint64_t> key) {
+    const auto mask = slots.size() - 1;
+    for (auto i = hash(key) & mask; ; i = (i + 1) & mask) {
+      if (slots[i] == NONE) {
+        slots[i] = entries.size();
+        keys.insert(keys.end(), key.begin(), key.end());
+        entries.push_back({NONE, NONE, false});
+        return slots[i];
+      }
+      if (std::ranges::equal(key, std::span{keys}.subspan(
+            slots[i] * key_words, key_words))) {
+        return slots[i];
+      }
     }
-    return create_vertex(kmer);
   }
 
-  auto increase_counts_backwards(Vertex v, std::string_view kmer) {
-    if (kmer.empty()) {
-      return;
+  auto find_entry(std::string_view kmer) {
+    if (unpacked_slots.empty()) {
+      unpacked_slots.assign(slots.size(), NONE);
     }
-    if (g.in_degree(v) == 1) {
-      for (const auto e : g.in_edges(v)) {
-        const auto u = g.source(e);
-        if (g[u].kmer.back() == kmer.back()) {
-          g[e].count++;
-          increase_counts_backwards(u, kmer.substr(0, kmer.size() - 1));
-        }
+    const auto mask = unpacked_slots.size() - 1;
+    for (auto i = std::hash<std::string_view>{}(kmer) & mask; ;
+         i = (i + 1) & mask) {
+      if (unpacked_slots[i] == NONE) {
+        unpacked_slots[i] = unpacked_kmers.size();
+        unpacked_kmers.push_back(kmer);
+        unpacked_entries.push_back(entries.size());
+        keys.resize(keys.size() + key_words);
+        entries.push_back({NONE, NONE, false});
+        return unpacked_entries.back();
+      }
+      if (unpacked_kmers[unpacked_slots[i]] == kmer) {
+        return unpacked_entries[unpacked_slots[i]];
       }
     }
   }
 
-  auto extend_chain(Vertex u, std::string_view kmer, bool is_ref) {
-    for (const auto e : g.out_edges(u)) {
-      const auto v = g.target(e);
-      if (g[v].kmer.back() == kmer.back()) {
-        g[e].count++;
+  auto index_kmers(std::string_view seq, std::uint32_t seq_id) {
+    const auto top_bits = 2 * kmer_size - 64 * (key_words - 1);
+    const auto top_mask = top_bits == 64 ? ~0ull : (1ull << top_bits) - 1;
+    key.assign(key_words, 0);
+    auto packed = std::span{key};
+    auto packable = std::size_t{};
+    for (auto i = std::size_t{}; i < seq.size(); i++) {
+      const auto base = encode(seq[i]);
+      packable = base < 0 ? 0 : packable + 1;
+      for (auto w = key_words - 1; w > 0; w--) {
+        packed[w] = packed[w] << 2 | packed[w - 1] >> 62;
+      }
+      packed[0] = packed[0] << 2 | (base & 3);
+      packed[key_words - 1] &= top_mask;
+      if (i + 1 < kmer_size) {
+        continue;
+      }
+      const auto entry = packable >= kmer_size
+        ? find_entry(packed)
+        : find_entry(seq.substr(i + 1 - kmer_size, kmer_size));
+      if (entries[entry].seq == seq_id) {
+        entries[entry].dup = true;
+      }
+      entries[entry].seq = seq_id;
+      kmer_entries.push_back(entry);
+    }
+  }
+
+  auto create_edge(Vertex u, Vertex v, bool is_ref) {
+    const auto e = Edge(edges.size());
+    edges.push_back({u, v, NONE, 1, is_ref, false,
+                     std::numeric_limits<double>::lowest()});
+    auto& node = nodes[u];
+    (node.first_out == NONE ? node.first_out : edges[node.last_out].next) = e;
+    node.last_out = e;
+    node.out_degree++;
+  }
+
+  auto get_vertex(std::string_view kmer, std::uint32_t entry) {
+    auto& [vertex, seq, dup] = entries[entry];
+    if (vertex != NONE) {
+      return vertex;
+    }
+    const auto v = Vertex(nodes.size());
+    nodes.push_back({kmer, NONE, NONE, 0});
+    if (!dup) {
+      vertex = v;
+      unique_vertices++;
+    }
+    return v;
+  }
+
+  auto extend_chain(Vertex u, std::string_view kmer, std::uint32_t entry,
+                    bool is_ref) {
+    for (auto e = nodes[u].first_out; e != NONE; e = edges[e].next) {
+      const auto v = edges[e].target;
+      if (nodes[v].kmer.back() == kmer.back()) {
+        edges[e].count++;
         return v;
       }
     }
-    const auto v = get_vertex(kmer);
+    const auto v = get_vertex(kmer, entry);
     create_edge(u, v, is_ref);
     return v;
   }
 
-  auto add_seq(std::string_view seq, bool is_ref) {
-    auto v = get_vertex(seq.substr(0, kmer_size));
-    // increase_counts_backwards(v, seq.substr(0, kmer_size-1));
+  auto add_seq(std::string_view seq, const std::uint32_t*& entry,
+               bool is_ref) {
+    auto v = get_vertex(seq.substr(0, kmer_size), *entry++);
     if (is_ref) {
       source = v;
     }
     for (auto i = 1; i <= seq.size() - kmer_size; i++) {
-      v = extend_chain(v, seq.substr(i, kmer_size), is_ref);
+      v = extend_chain(v, seq.substr(i, kmer_size), *entry++, is_ref);
     }
     if (is_ref) {
       sink = v;
     }
   }
 
-  auto path_finder(Vertex from, Vertex to, Path& path) -> void {
-    path.push_back(from);
-    if (from == to) {
-      paths.push_back(path);
-      for (const auto v : path) { 
-        vertices_on_paths.insert(v);
+  auto is_kept(Edge e) const {
+    return edges[e].is_ref || edges[e].count >= para.PRUNE_FACTOR
+      || nodes[edges[e].source].out_degree == 1;
+  }
+
+  auto find_all_paths() {
+    if (nodes.empty()) {
+      return;
+    }
+    /* iterative dfs, the next edge to try of each vertex on the path */
+    auto& on_path = marks;
+    auto& next = stack;
+    on_path.assign(nodes.size(), false);
+    path.clear();
+    next.assign(1, nodes[source].first_out);
+    on_path[source] = true;
+    if (source == sink) {
+      path_ends.push_back(0);
+      return;
+    }
+    while (!next.empty()) {
+      auto e = next.back();
+      while (e != NONE && (!is_kept(e) || on_path[edges[e].target])) {
+        e = edges[e].next;
       }
-    } else {
-      for (const auto e : g.out_edges(from)) {
-        if (g[e].is_ref || g[e].count >= para.PRUNE_FACTOR
-            || g.out_degree(from) == 1) {
-          const auto v = g.target(e);
-          if (std::ranges::find(path, v) == path.end()) { 
-            path_finder(v, to, path);
-          }
+      if (e == NONE) {
+        next.pop_back();
+        on_path[path.empty() ? source : edges[path.back()].target] = false;
+        if (!path.empty()) {
+          path.pop_back();
         }
+        continue;
+      }
+      next.back() = edges[e].next;
+      const auto v = edges[e].target;
+      path.push_back(e);
+      if (v == sink) {
+        path_edges.insert(path_edges.end(), path.begin(), path.end());
+        path_ends.push_back(path_edges.size());
+        path.pop_back();
+      } else {
+        on_path[v] = true;
+        next.push_back(nodes[v].first_out);
       }
     }
-    path.pop_back();
-  }
-
-  auto find_all_paths() {
-    auto path = Path{};
-    path_finder(source, sink, path);
   }
 
   auto mark_edges_on_paths() {
-    for (const auto& path : paths) {
-      auto u = path[0];
-      for (auto i = 1u; i < path.size(); i++) {
-        const auto v = path[i];
-        g[g.edge(u, v)].is_on_path = true;
-        u = v;
-      }
+    for (const auto e : path_edges) {
+      edges[e].is_on_path = true;
     }
   }
 
   auto compute_edges_score() {
-    for (const auto v : vertices_on_paths) {
-      auto edges = std::vector<Edge> {};
-      for (const auto e : g.out_edges(v)) {
-        if (g[e].is_on_path) {
-          edges.push_back(e);
-        }
+    sums.assign(nodes.size(), 0);
+    for (const auto& edge : edges) {
+      if (edge.is_on_path) {
+        sums[edge.source] += edge.count;
+      }
+    }
+    for (auto& edge : edges) {
+      if (edge.is_on_path) {
+        edge.score = std::log10(edge.count / sums[edge.source]);
       }
-      auto sum = std::accumulate(edges.begin(), edges.end(), 0.0, 
-        [this](double sum, const Edge& e) {
-          return sum + g[e].count;
-        }
-      );
-      std::ranges::for_each(edges, [this, &sum](const Edge& e) {
-        g[e].score = std::log10(g[e].count / sum);
-      });
     }
   }
 
-  auto get_haplotypes() {
-    auto haplotypes = std::vector<Haplotype>{};
-
-    for (const auto& path : paths) {
-      auto u = path[0];
-      auto seq = std::string(g[u].kmer.data(), g[u].kmer.size());
+  auto get_haplotypes(std::vector<Haplotype>& haplotypes) {
+    /* the strings of the haplotypes given are reused */
+    haplotypes.resize(path_ends.size());
+    auto begin = std::size_t{};
+    for (auto p = 0u; p < path_ends.size(); p++) {
+      const auto end = path_ends[p];
+      auto seq = std::move(haplotypes[p].seq);
+      seq = nodes[source].kmer;
+      seq.reserve(seq.size() + end - begin);
       auto score = 0.0;
-      for (auto i = 1; i < path.size(); i++) {
-        auto v = path[i];
-        seq += g[v].kmer.back();
-        score += g[g.edge(u, v)].score;
-        u = v;
+      for (auto i = begin; i < end; i++) {
+        const auto& edge = edges[path_edges[i]];
+        seq += nodes[edge.target].kmer.back();
+        score += edge.score;
       }
-      haplotypes.push_back({.seq = std::move(seq), .score = score});
+      haplotypes[p] = Haplotype{.seq = std::move(seq), .score = score};
+      begin = end;
     }
-
     std::ranges::sort(haplotypes, std::ranges::greater {}, &Haplotype::score);
 
     if (haplotypes.size() > para.DEFAULT_NUM_PATHS) {
@@ -216,7 +321,7 @@ private:
     }
 
     for (auto& h : haplotypes) {
-      auto [align_begin, cigar] = SmithWaterman::align(ref, h.seq);
+      auto [align_begin, cigar] = SmithWaterman::align(ref, h.seq, sw_workspace);
       // SPDLOG_DEBUG("Adding haplotype {} from graph with kmer {}", cigar, kmer_size);
       h.align_begin_wrt_ref = align_begin;
       h.cigar = std::move(cigar);
@@ -226,25 +331,35 @@ private:
       SPDLOG_DEBUG("{}", h.seq);
       // SPDLOG_DEBUG("> Cigar = {} score {}", h.cigar, h.score);
     }
-    return haplotypes;
   }
 
 public:
 
-  HaplotypeGraph(int kmer_size) : kmer_size(kmer_size) {
+  HaplotypeGraph(int kmer_size)
+  : kmer_size(kmer_size), key_words((2 * kmer_size + 63) / 64) {
 
   }
 
-  static auto get_dup_kmers(std::string_view seq, int size) {
-    auto all_kmers = std::set<std::string_view> {};
-    auto dup_kmers = std::set<std::string_view> {};
-    for (auto i = 0; i <= seq.size() - size; i++) {
-      const auto kmer = seq.substr(i, size);
-      if (auto [iter, success] = all_kmers.insert(kmer); !success) {
-        dup_kmers.insert(kmer);
-      }
-    }
-    return dup_kmers;
+  /**
+   * @brief Empty the graph to assemble again with another kmer size. The
+   * memory of the graph, the kmer table and the paths is kept.
+   */
+  auto reset(std::size_t kmer_size) {
+    this->kmer_size = kmer_size;
+    key_words = (2 * kmer_size + 63) / 64;
+    unique_vertices = 0;
+    source = sink = 0;
+    ref = {};
+    read_segs.clear();
+    nodes.clear();
+    edges.clear();
+    path_edges.clear();
+    path_ends.clear();
+    entries.clear();
+    keys.clear();
+    unpacked_kmers.clear();
+    unpacked_entries.clear();
+    kmer_entries.clear();
   }
 
   auto set_ref(std::string_view ref) {
@@ -272,37 +387,76 @@ public:
   }
 
   auto build() {
-    for (const auto kmer : get_dup_kmers(ref, kmer_size)) {
-      dup_kmers.insert(kmer);
-    }
+    /* a kmer seen twice in the ref or in one read segment is duplicated, and
+     * gets a vertex of its own on each occurrence */
+    auto kmers = ref.size() < kmer_size ? 0 : ref.size() - kmer_size + 1;
     for (const auto seg : read_segs) {
-      for (const auto kmer : get_dup_kmers(seg, kmer_size)) {
-        dup_kmers.insert(kmer);
-      }
+      kmers += seg.size() - kmer_size + 1;
     }
-    add_seq(ref, true);
-    for (const auto seg : read_segs) { 
-      add_seq(seg, false);
+    slots.assign(std::bit_ceil(std::max<std::size_t>(2 * kmers, 16)), NONE);
+    unpacked_slots.clear();
+    kmer_entries.reserve(kmers);
+    entries.reserve(kmers);
+    keys.reserve(kmers * key_words);
+
+    index_kmers(ref, 0);
+    for (auto i = 0u; i < read_segs.size(); i++) {
+      index_kmers(read_segs[i], i + 1);
+    }
+
+    nodes.reserve(entries.size());
+    edges.reserve(entries.size());
+    auto entry = std::as_const(kmer_entries).data();
+    if (ref.size() >= kmer_size) {
+      add_seq(ref, entry, true);
+    }
+    for (const auto seg : read_segs) {
+      add_seq(seg, entry, false);
     }
   }
 
-  auto has_cycles() const {
-    auto has_cycle = false;
-    auto vis = cycle_detector {has_cycle};
-    auto fg = g.filtered_graph(filter);
-    boost::depth_first_search(fg, boost::visitor(vis));
-    return has_cycle;
+  auto has_cycles() {
+    /* a vertex is sorted once all its in edges are, the rest lie on or
+     * behind a cycle */
+    auto& in_degrees = marks;
+    auto& sorted = stack;
+    in_degrees.assign(nodes.size(), 0);
+    for (auto e = Edge{}; e < edges.size(); e++) {
+      if (is_kept(e)) {
+        in_degrees[edges[e].target]++;
+      }
+    }
+    sorted.clear();
+    for (auto v = Vertex{}; v < nodes.size(); v++) {
+      if (in_degrees[v] == 0) {
+        sorted.push_back(v);
+      }
+    }
+    for (auto i = std::size_t{}; i < sorted.size(); i++) {
+      for (auto e = nodes[sorted[i]].first_out; e != NONE; e = edges[e].next) {
+        if (is_kept(e) && --in_degrees[edges[e].target] == 0) {
+          sorted.push_back(edges[e].target);
+        }
+      }
+    }
+    return sorted.size() < nodes.size();
   }
 
   auto unique_kmers_count() const {
-    return unique_kmers.size();
+    return unique_vertices;
   }
 
-  auto find_paths() {
+  auto find_paths(std::vector<Haplotype>& haplotypes) {
     find_all_paths();
     mark_edges_on_paths();
     compute_edges_score();
-    return get_haplotypes();
+    get_haplotypes(haplotypes);
+  }
+
+  auto find_paths() {
+    auto haplotypes = std::vector<Haplotype>{};
+    find_paths(haplotypes);
+    return haplotypes;
   }
 };
 
@@ -4,10 +4,15 @@
 #include <biovoltron/algo/align/inexact_match/smithwaterman_sse.hpp>
 #include <biovoltron/algo/align/mapq/mapq.hpp>
 #include <biovoltron/algo/sort/stable_sorter.hpp>
+#include <biovoltron/file_io/bam_record.hpp>
 #include <biovoltron/file_io/fasta.hpp>
 #include <biovoltron/file_io/fastq.hpp>
 #include <biovoltron/file_io/sam.hpp>
-#include <map>
+#include <array>
+#include <chrono>
+#include <numeric>
+#include <optional>
+#include <ostream>
 #include <spdlog/spdlog.h>
 #include <sstream>
 
@@ -20,7 +25,7 @@ namespace biovoltron {
 /**
  * @ingroup applications
  * 
- * @brief Paired-end short-read aligner (~150bp) optimized for hs37d5 using FM-index and SSE SW.
+ * @brief Short-read aligner (~150bp) optimized for hs37d5 using FM-index and SSE SW.
  * 
  * @details 
  * A highly optimized Aligner (implemented using modern C++20) 
@@ -33,6 +38,18 @@ namespace biovoltron {
  * 
  * If you know the mean and variance of the insert size of the 
  * sequencing data, we highly recommend you pass it into the aligner.
+ * Otherwise, @ref BurrowWheelerAligner::generate_sam_batch estimates
+ * the insert size from the first confidently paired reads of each
+ * batch and uses it for pairing and rescue.
+ *
+ * Single-end libraries are mapped with the single-read overloads of
+ * @ref BurrowWheelerAligner::map and
+ * @ref BurrowWheelerAligner::generate_sam, which skip pairing and rescue.
+ *
+ * For whole-genome alignment, concatenate all contigs with
+ * @ref BurrowWheelerAligner::concat_ref, build one index over the result
+ * and pass the contig-boundary table as `chr_bounds`; positions are then
+ * reported per contig and alignments spanning two contigs are dropped.
  *
  * Example:
  * ```cpp
@@ -102,8 +119,11 @@ struct BurrowWheelerAligner {
    */
   struct Parameters {
     const int INSERT_MEAN = 550;   ///< Mean insert size (bp).
-    const int INSERT_VAR = 150;    ///< Insert size variance (bp^2).
+    const int INSERT_VAR = 150;    ///< Insert size standard deviation (bp).
     const int PAIR_DIST = INSERT_MEAN + 4 * INSERT_VAR + 50; ///< Max pairing distance.
+    const int INSERT_SAMPLE_CNT = 256;    ///< Pairs per batch sampled for insert size.
+    const int MIN_INSERT_SAMPLE_CNT = 32; ///< Min confident pairs to replace the prior.
+    const int INSERT_MAPQ = 20;           ///< Min MAPQ of both mates to be sampled.
 
     const int MAX_HIT_CNT = 512;   ///< Max FM-index hits per seed.
     const int MAX_EM_CNT = 128;    ///< Max exact match candidates kept.
@@ -122,9 +142,82 @@ struct BurrowWheelerAligner {
     const int PEN_UNPAIRED = 19;   ///< Penalty for unpaired alignments.
   };
 
+  /**
+   * @brief Boundary of one contig in a concatenated reference.
+   */
+  struct ChromBound {
+    std::string chrom;             ///< Contig name.
+    std::uint32_t last_elem_pos{}; ///< Global position of the contig's last base.
+  };
+
   const FastaRecord<true> ref; ///< Reference genome sequence.
   const FMIndex<1, uint32_t, StableSorter<uint32_t>> index; ///< FM-index of reference.
   const Parameters args; ///< Algorithm parameters.
+  /// Contig boundaries of `ref`, sorted; empty if `ref` is a single contig.
+  const std::vector<ChromBound> chr_bounds{};
+
+  /**
+   * @brief Concatenates a multi-record reference for whole-genome alignment.
+   * @return The concatenated reference (named after the first record) and
+   * its contig-boundary table.
+   */
+  static auto
+  concat_ref(const std::vector<FastaRecord<true>>& refs) {
+    auto ref = FastaRecord<true>{};
+    auto chr_bounds = std::vector<ChromBound>{};
+    chr_bounds.reserve(refs.size());
+    if (!refs.empty())
+      ref.name = refs.front().name;
+    for (const auto& record : refs) {
+      ref.seq += record.seq;
+      chr_bounds.emplace_back(record.name, ref.seq.size() - 1);
+    }
+    return std::pair{std::move(ref), std::move(chr_bounds)};
+  }
+
+  /**
+   * @brief Index of the contig containing global position `pos`.
+   * @details Branch-free lower bound over `chr_bounds`; the loop only
+   * depends on the number of contigs. Returns `chr_bounds.size()` if `pos`
+   * is past the last contig.
+   */
+  auto
+  get_chr_idx(std::uint32_t pos) const noexcept {
+    if (chr_bounds.empty())
+      return std::size_t{};
+    auto base = chr_bounds.data();
+    for (auto len = chr_bounds.size(); len > 1;) {
+      const auto half = len / 2;
+      base = (base[half - 1].last_elem_pos < pos) ? base + half : base;
+      len -= half;
+    }
+    return static_cast<std::size_t>(base - chr_bounds.data())
+           + (base->last_elem_pos < pos);
+  }
+
+  /**
+   * @brief Translates a global position to (contig name, contig position).
+   */
+  auto
+  get_chr_pos(std::uint32_t pos) const -> std::pair<std::string_view, std::uint32_t> {
+    if (chr_bounds.empty())
+      return {ref.name, pos};
+    const auto idx = get_chr_idx(pos);
+    if (idx == chr_bounds.size())
+      return {"*", pos};
+    return {chr_bounds[idx].chrom,
+            idx == 0 ? pos : pos - chr_bounds[idx - 1].last_elem_pos - 1};
+  }
+
+  /**
+   * @brief Checks whether `[pos, pos + len)` spans more than one contig.
+   */
+  auto
+  crosses_bound(std::uint32_t pos, std::uint32_t len) const noexcept {
+    if (chr_bounds.empty())
+      return false;
+    return get_chr_idx(pos) != get_chr_idx(pos + std::max(len, 1u) - 1);
+  }
 
   /**
    * @brief Prints current parameters to debug log.
@@ -150,6 +243,61 @@ struct BurrowWheelerAligner {
     SPDLOG_DEBUG("INSERT_MEAN: {}", args.INSERT_MEAN);
     SPDLOG_DEBUG("INSERT_VAR: {}", args.INSERT_VAR);
     SPDLOG_DEBUG("PAIR_DIST: {}", args.PAIR_DIST);
+    SPDLOG_DEBUG("INSERT_SAMPLE_CNT: {}", args.INSERT_SAMPLE_CNT);
+    SPDLOG_DEBUG("MIN_INSERT_SAMPLE_CNT: {}", args.MIN_INSERT_SAMPLE_CNT);
+    SPDLOG_DEBUG("INSERT_MAPQ: {}", args.INSERT_MAPQ);
+  }
+
+  /**
+   * @brief Insert-size model used for pairing, rescue and MAPQ penalty.
+   * @details Same meaning as the `INSERT_*` and `PAIR_DIST` parameters.
+   */
+  struct InsertSize {
+    int mean{};      ///< Mean insert size (bp).
+    int dev{};       ///< Insert size standard deviation (bp).
+    int pair_dist{}; ///< Max pairing distance.
+  };
+
+  /**
+   * @brief The insert-size prior given by @ref Parameters.
+   */
+  auto
+  default_insert_size() const noexcept {
+    return InsertSize{args.INSERT_MEAN, args.INSERT_VAR, args.PAIR_DIST};
+  }
+
+  /**
+   * @brief Estimates the insert size from observed pair distances.
+   * @details Distances outside `[Q1 - 2 * IQR, Q3 + 2 * IQR]` are treated
+   * as outliers; the pairing distance is derived from the remaining
+   * mean and standard deviation as in @ref Parameters.
+   * @return std::nullopt if fewer than MIN_INSERT_SAMPLE_CNT distances
+   * are given.
+   */
+  auto
+  estimate_insert_size(std::vector<int> dists) const -> std::optional<InsertSize> {
+    if (dists.size() < args.MIN_INSERT_SAMPLE_CNT)
+      return std::nullopt;
+    std::ranges::sort(dists);
+    const auto q1 = dists[dists.size() / 4];
+    const auto q3 = dists[dists.size() * 3 / 4];
+    const auto low = q1 - 2 * (q3 - q1);
+    const auto high = q3 + 2 * (q3 - q1);
+
+    auto cnt = 0;
+    auto sum = 0.0, sq_sum = 0.0;
+    for (const auto dist : dists) {
+      if (dist < low || dist > high)
+        continue;
+      cnt++;
+      sum += dist;
+      sq_sum += static_cast<double>(dist) * dist;
+    }
+    const auto mean = sum / cnt;
+    const auto dev = std::sqrt(std::max(sq_sum / cnt - mean * mean, 1.0));
+    const auto insert_mean = static_cast<int>(mean + 0.5);
+    const auto insert_dev = static_cast<int>(dev + 0.5);
+    return InsertSize{insert_mean, insert_dev, insert_mean + 4 * insert_dev + 50};
   }
 
   /**
@@ -251,6 +399,165 @@ struct BurrowWheelerAligner {
     }
   };
 
+  /**
+   * @brief Stage-level counters and cumulative timers of the aligner.
+   * @details
+   * A profile is not synchronized: keep one instance per thread, pass it
+   * to @ref map / @ref generate_sam, merge the instances with `+=` and
+   * dump the total with @ref to_json at the end of a run.
+   *
+   * Example:
+   * ```cpp
+   * auto profiles = std::vector<BurrowWheelerAligner::Profile>(threads);
+   * // thread i: aligner.generate_sam(read, profiles[i]);
+   * auto total = BurrowWheelerAligner::Profile{};
+   * for (const auto& profile : profiles) total += profile;
+   * total.to_json(std::cerr);
+   * ```
+   */
+  struct Profile {
+    using clock = std::chrono::steady_clock;
+
+    /// Aligner stages that are timed.
+    enum Stage : std::uint8_t {
+      SEEDING,
+      EXACT_MATCH,
+      KMER_FILTER,
+      EXTENDING,
+      RESCUE,
+      PAIRING,
+      GENERATE_SAM,
+      STAGE_CNT
+    };
+
+    constexpr static auto STAGE_NAMES = std::array{
+      "seeding", "exact_match", "kmer_filter", "extending",
+      "rescue",  "pairing",     "generate_sam"};
+
+    std::array<std::chrono::nanoseconds, STAGE_CNT> elapsed{}; ///< Time per stage.
+    std::uint64_t read_cnt{};        ///< Reads mapped.
+    std::uint64_t seed_cnt{};        ///< Seeds used for chaining.
+    std::uint64_t anchor_cnt{};      ///< Anchors (seed hits) chained.
+    std::uint64_t chain_cnt{};       ///< Chains produced by seeding.
+    std::uint64_t exact_match_cnt{}; ///< Alignments found by exact match.
+    std::uint64_t sw_cnt{};          ///< Smith-Waterman calls.
+    std::uint64_t rescue_cnt{};      ///< Alignments obtained via rescue.
+
+    /**
+     * @brief Charges the time since `start` to `stage`.
+     * @return The current time, to be used as the start of the next stage.
+     */
+    auto
+    lap(Stage stage, clock::time_point start) {
+      const auto now = clock::now();
+      elapsed[stage] += now - start;
+      return now;
+    }
+
+    auto&
+    operator+=(const Profile& other) {
+      for (auto i = 0; i < STAGE_CNT; i++) elapsed[i] += other.elapsed[i];
+      read_cnt += other.read_cnt;
+      seed_cnt += other.seed_cnt;
+      anchor_cnt += other.anchor_cnt;
+      chain_cnt += other.chain_cnt;
+      exact_match_cnt += other.exact_match_cnt;
+      sw_cnt += other.sw_cnt;
+      rescue_cnt += other.rescue_cnt;
+      return *this;
+    }
+
+    /**
+     * @brief Writes the counters, per-read averages and stage timers
+     * (in milliseconds) as a JSON object.
+     */
+    auto
+    to_json(std::ostream& os) const -> std::ostream& {
+      const auto reads = static_cast<double>(std::max<std::uint64_t>(read_cnt, 1));
+      const auto counters = std::array{
+        std::pair{"seeds", seed_cnt},   std::pair{"anchors", anchor_cnt},
+        std::pair{"chains", chain_cnt}, std::pair{"exact_matches", exact_match_cnt},
+        std::pair{"sw_calls", sw_cnt},  std::pair{"rescues", rescue_cnt}};
+
+      os << "{\"reads\": " << read_cnt << ", \"counters\": {";
+      for (auto i = 0; const auto& [name, cnt] : counters)
+        os << (i++ ? ", " : "") << '"' << name << "\": " << cnt;
+      os << "}, \"per_read\": {";
+      for (auto i = 0; const auto& [name, cnt] : counters)
+        os << (i++ ? ", " : "") << '"' << name << "\": " << cnt / reads;
+      os << "}, \"elapsed_ms\": {";
+      for (auto i = 0; i < STAGE_CNT; i++)
+        os << (i ? ", " : "") << '"' << STAGE_NAMES[i] << "\": "
+           << std::chrono::duration<double, std::milli>(elapsed[i]).count();
+      return os << "}}";
+    }
+  };
+
+  /**
+   * @brief Groups anchors into chains by diagonal (`ref_pos - seed_pos`).
+   * @details Anchors are visited in order. An anchor joins every chain
+   * whose key diagonal lies within SEED_LEN of its own, or starts a chain
+   * keyed by its diagonal if there is none. As keys are more than SEED_LEN
+   * apart, an anchor joins at most two chains, found with one branch-free
+   * search over a flat sorted key array. The (key, anchor) memberships are
+   * then radix sorted by key, which keeps arrival order within a key, and
+   * cut into chains by a linear sweep. Chains come out in key order, each
+   * with its anchors sorted.
+   */
+  auto
+  chain_anchors(const std::vector<Anchor>& anchors) const {
+    using Member = std::pair<std::uint32_t, Anchor>;
+    const auto seed_len = static_cast<std::uint32_t>(args.SEED_LEN);
+    auto keys = std::vector<std::uint32_t>{};
+    auto members = std::vector<Member>{};
+    members.reserve(anchors.size() * 2);
+    for (const auto anchor : anchors) {
+      const auto read_pos = anchor.ref_pos - anchor.seed_pos;
+      const auto lower = read_pos > seed_len ? read_pos - seed_len : 0;
+      const auto upper = read_pos + std::min(seed_len, ~read_pos);
+      auto base = keys.data();
+      for (auto len = keys.size(); len > 1;) {
+        const auto half = len / 2;
+        base = (base[half - 1] < lower) ? base + half : base;
+        len -= half;
+      }
+      const auto first = base - keys.data() + (!keys.empty() && *base < lower);
+      auto joined = false;
+      for (auto i = first; i < keys.size() && keys[i] <= upper; i++) {
+        members.emplace_back(keys[i], anchor);
+        joined = true;
+      }
+      if (!joined) {
+        keys.insert(keys.begin() + first, read_pos);
+        members.emplace_back(read_pos, anchor);
+      }
+    }
+
+    // LSD radix sort by key, skipping bytes shared by all keys.
+    auto buffer = std::vector<Member>(members.size());
+    for (auto shift = 0; shift < 32; shift += 8) {
+      auto offsets = std::array<std::uint32_t, 257>{};
+      for (const auto& [key, anchor] : members) offsets[(key >> shift & 0xff) + 1]++;
+      if (std::ranges::any_of(offsets, [&](auto cnt) { return cnt == members.size(); }))
+        continue;
+      std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+      for (const auto& member : members)
+        buffer[offsets[member.first >> shift & 0xff]++] = member;
+      members.swap(buffer);
+    }
+
+    auto chains = std::vector<std::vector<Anchor>>{};
+    chains.reserve(keys.size());
+    for (auto i = std::size_t{}; i < members.size();) {
+      auto& chain = chains.emplace_back();
+      const auto key = members[i].first;
+      for (; i < members.size() && members[i].first == key; i++)
+        chain.push_back(members[i].second);
+      std::ranges::sort(chain);
+    }
+    return chains;
+  }
+
  private:
   /// Helper to compute absolute difference between two values.
   constexpr static auto DIFF
@@ -278,6 +585,18 @@ struct BurrowWheelerAligner {
     }
   }
 
+  /**
+   * @brief Removes candidate alignments spanning a contig boundary.
+   */
+  auto
+  drop_cross_bound(std::vector<Aln>& alns, std::uint32_t read_size) const {
+    if (chr_bounds.size() <= 1)
+      return;
+    std::erase_if(alns, [this, read_size](const auto& aln) {
+      return crosses_bound(aln.pos, read_size);
+    });
+  }
+
   /**
    * @brief Finalizes alignments by deduplication and filtering.
    * @details Removes duplicates, sorts, and applies score filtering.
@@ -339,7 +658,7 @@ struct BurrowWheelerAligner {
    * @details Runs Smith–Waterman refinement on candidate region.
    */
   auto
-  set_cigar(Aln& aln, istring_view read, auto& profile) const {
+  set_cigar(Aln& aln, istring_view read, auto& profile, Profile& stats) const {
     SPDLOG_DEBUG("============== compute cigar ==============");
 
     if (!aln.cigar.empty())
@@ -359,6 +678,7 @@ struct BurrowWheelerAligner {
       profile = SseSmithWaterman::get_profile(read);
     auto sw
       = SseSmithWaterman::align(profile, subref, true, true, args.SW_THRESHOLD);
+    stats.sw_cnt++;
 
     const auto ref_beg = sw_pos + sw.ref_beg;
     const auto ref_end = sw_pos + sw.ref_end;
@@ -488,12 +808,12 @@ struct BurrowWheelerAligner {
   auto
   get_best_one(const std::vector<Aln>& alns, istring_view read,
                istring_view rread, auto& profile, auto& rprofile,
-               float frac_rep) const {
+               float frac_rep, Profile& stats) const {
     auto aln = alns.front();
     if (aln.forward)
-      set_cigar(aln, read, profile);
+      set_cigar(aln, read, profile, stats);
     else
-      set_cigar(aln, rread, rprofile);
+      set_cigar(aln, rread, rprofile, stats);
     const auto [mapq, sub_score] = compute_se_mapq(alns, frac_rep);
     aln.mapq = mapq;
     aln.sub_score = sub_score;
@@ -502,20 +822,21 @@ struct BurrowWheelerAligner {
 
   /**
    * @brief Pairs alignments from two reads based on genomic distance.
-   * @details Uses PAIR_DIST threshold; sorts by combined score.
+   * @details Uses the pair_dist threshold; sorts by combined score.
    * @note This is an O(NlogN) operation.
    */
   auto
-  pairing2(std::vector<Aln> alns1, std::vector<Aln> alns2) const {
+  pairing2(std::vector<Aln> alns1, std::vector<Aln> alns2,
+           int pair_dist) const {
     std::ranges::sort(alns1);
     std::ranges::sort(alns2);
     auto aln_pairs = std::vector<AlnPair>{};
     auto begin = alns2.begin();
     auto end = begin;
     for (const auto& aln1 : alns1) {
-      while (begin != alns2.end() && begin->pos < aln1.pos - args.PAIR_DIST)
+      while (begin != alns2.end() && begin->pos < aln1.pos - pair_dist)
         ++begin;
-      while (end != alns2.end() && end->pos < aln1.pos + args.PAIR_DIST) ++end;
+      while (end != alns2.end() && end->pos < aln1.pos + pair_dist) ++end;
       for (auto it = begin; it != end; ++it) {
         const auto& aln2 = *it;
         if (aln1.forward != aln2.forward)
@@ -627,7 +948,7 @@ struct BurrowWheelerAligner {
    * @brief Seeds one orientation of a read.
    */
   auto
-  seeding_impl(istring_view read, bool forward) const {
+  seeding_impl(istring_view read, bool forward, Profile& stats) const {
     const auto frags = split_read(read);
     SPDLOG_DEBUG("\n************ read seeds ************");
 
@@ -646,25 +967,12 @@ struct BurrowWheelerAligner {
       const auto seed_pos = seed.data() - read.data();
       for (const auto ref_pos : span)
         anchors.emplace_back(ref_pos, seed_pos, seed.size(), forward);
+      stats.seed_cnt++;
     }
+    stats.anchor_cnt += anchors.size();
 
-    auto chain_map = std::map<std::uint32_t, std::vector<Anchor>>{};
-    for (const auto anchor : anchors) {
-      const auto read_pos = anchor.ref_pos - anchor.seed_pos;
-      const auto lower = chain_map.lower_bound(read_pos - args.SEED_LEN);
-      const auto upper = chain_map.upper_bound(read_pos + args.SEED_LEN);
-      if (lower != upper) {
-        for (auto it = lower; it != upper; ++it) it->second.push_back(anchor);
-        continue;
-      }
-      chain_map[read_pos].push_back(anchor);
-    }
-
-    auto chains = std::vector<std::vector<Anchor>>{};
-    for (auto& chain : chain_map | std::views::values) {
-      std::ranges::sort(chain);
-      chains.push_back(std::move(chain));
-    }
+    auto chains = chain_anchors(anchors);
+    stats.chain_cnt += chains.size();
     return std::pair{std::move(chains), repeats};
   }
 
@@ -672,8 +980,8 @@ struct BurrowWheelerAligner {
    * @brief Seeds both orientations and merges chains.
    */
   auto
-  seeding(istring_view read, istring_view rread) const {
-    auto [chains, repeats] = seeding_impl(read, true);
+  seeding(istring_view read, istring_view rread, Profile& stats) const {
+    auto [chains, repeats] = seeding_impl(read, true, stats);
 
     SPDLOG_DEBUG("\n************ reverse ************");
     std::stringstream ss;
@@ -682,7 +990,7 @@ struct BurrowWheelerAligner {
       ss << (rread[i] != 4 ? Codec::to_char(rread[i]) : '|');
     SPDLOG_DEBUG("{}", ss.str());
 
-    const auto [rchains, rrepeats] = seeding_impl(rread, false);
+    const auto [rchains, rrepeats] = seeding_impl(rread, false, stats);
     std::ranges::copy(rchains, std::back_inserter(chains));
     std::ranges::sort(chains, std::ranges::greater{},
                       &std::vector<Anchor>::size);
@@ -814,7 +1122,7 @@ struct BurrowWheelerAligner {
    */
   auto
   extending(std::vector<Aln>& alns, const std::vector<Aln>& sw_alns,
-            istring_view read, istring_view rread) const {
+            istring_view read, istring_view rread, Profile& stats) const {
     auto profile = s_profile{}, rprofile = s_profile{};
     for (auto min_score = args.SW_THRESHOLD; const auto& sw_aln : sw_alns) {
       const auto subref = istring_view{ref.seq}.substr(
@@ -829,6 +1137,7 @@ struct BurrowWheelerAligner {
           rprofile = SseSmithWaterman::get_profile(rread);
         sw = SseSmithWaterman::align(rprofile, subref, false, false, min_score);
       }
+      stats.sw_cnt++;
 
       const auto score = static_cast<int>(sw.score);
       if (score < min_score)
@@ -859,7 +1168,7 @@ struct BurrowWheelerAligner {
          istring_view read2, istring_view rread2, auto& profile2,
          auto& rprofile2, const std::vector<std::uint32_t>& kmers2,
          const std::vector<std::uint32_t>& rkmers2, std::vector<bool>& table,
-         int min_find_cnt) const {
+         int min_find_cnt, int pair_dist, Profile& stats) const {
     const auto [opt_score, sub_score, sub_cnt]
       = get_opt_subopt_count(alns1 | std::views::transform(&Aln::score));
     const auto rescue_cnt = std::min(sub_cnt + 1, args.MAX_RESCUE_CNT);
@@ -872,8 +1181,8 @@ struct BurrowWheelerAligner {
       const auto pos1 = aln1.pos;
       if (std::ranges::any_of(
             alns2,
-            [pos1, PAIR_DIST = this->args.PAIR_DIST](const auto pos2) {
-              return DIFF(pos1, pos2) <= PAIR_DIST;
+            [pos1, pair_dist](const auto pos2) {
+              return DIFF(pos1, pos2) <= pair_dist;
             },
             &Aln::pos)) {
         SPDLOG_DEBUG("pos: {} already seen.", pos1);
@@ -881,9 +1190,9 @@ struct BurrowWheelerAligner {
       }
 
       const auto forward1 = aln1.forward;
-      const auto sw_pos = forward1 ? pos1 - args.EXTEND : pos1 - args.PAIR_DIST;
+      const auto sw_pos = forward1 ? pos1 - args.EXTEND : pos1 - pair_dist;
       const auto subref = istring_view{ref.seq}.substr(
-        sw_pos, args.EXTEND + read2.size() + args.PAIR_DIST);
+        sw_pos, args.EXTEND + read2.size() + pair_dist);
 
       const auto find_cnt
         = find_kmers(forward1 ? rkmers2 : kmers2, subref, table);
@@ -902,6 +1211,7 @@ struct BurrowWheelerAligner {
           profile2 = SseSmithWaterman::get_profile(read2);
         sw = SseSmithWaterman::align(profile2, subref, false, false, min_score);
       }
+      stats.sw_cnt++;
 
       const auto score = static_cast<int>(sw.score);
       if (score < min_score)
@@ -917,6 +1227,7 @@ struct BurrowWheelerAligner {
         = true;
       min_score = std::max(min_score, score - args.MAX_SW_DIFF);
     }
+    stats.rescue_cnt += rescues.size();
 
     return rescues;
   }
@@ -961,9 +1272,8 @@ struct BurrowWheelerAligner {
    * @brief Computes insert size penalty for pairing.
    */
   auto
-  insert_penalty(int dist) const {
-    const auto ns
-      = (dist - args.INSERT_MEAN) / static_cast<double>(args.INSERT_VAR);
+  insert_penalty(int dist, const InsertSize& insert) const {
+    const auto ns = (dist - insert.mean) / static_cast<double>(insert.dev);
     return static_cast<int>(std::pow(ns, 2));
   }
 
@@ -975,7 +1285,8 @@ struct BurrowWheelerAligner {
                 const std::vector<AlnPair>& aln_pairs, istring_view read1,
                 istring_view rread1, auto& profile1, auto& rprofile1,
                 istring_view read2, istring_view rread2, auto& profile2,
-                auto& rprofile2, float frac_rep1, float frac_rep2) const {
+                auto& rprofile2, float frac_rep1, float frac_rep2,
+                const InsertSize& insert, Profile& stats) const {
     SPDLOG_DEBUG("************ pairing results ************");
     print_paires(aln_pairs);
 
@@ -994,13 +1305,13 @@ struct BurrowWheelerAligner {
       aln2 = alns2.front();
     }
     if (aln1.forward)
-      set_cigar(aln1, read1, profile1);
+      set_cigar(aln1, read1, profile1, stats);
     else
-      set_cigar(aln1, rread1, rprofile1);
+      set_cigar(aln1, rread1, rprofile1, stats);
     if (aln2.forward)
-      set_cigar(aln2, read2, profile2);
+      set_cigar(aln2, read2, profile2, stats);
     else
-      set_cigar(aln2, rread2, rprofile2);
+      set_cigar(aln2, rread2, rprofile2, stats);
     if (!success) {
       aln1.mapq = mem_approx_mapq_se({aln1.score, aln1.score2, sub_score1,
                                       aln1.align_len, sub_cnt1, frac_rep1});
@@ -1014,7 +1325,7 @@ struct BurrowWheelerAligner {
                        sub_cnt2, frac_rep2},
                       score_un, opt_score, sub_score, sub_cnt);
       SPDLOG_DEBUG("(raw mapq1:{}, raw mapq2: {})", mapq1, mapq2);
-      const auto pen_paired = insert_penalty(aln_pairs.front().dist());
+      const auto pen_paired = insert_penalty(aln_pairs.front().dist(), insert);
       aln1.mapq = std::max(mapq1 - pen_paired, 0);
       aln2.mapq = std::max(mapq2 - pen_paired, 0);
     }
@@ -1029,27 +1340,35 @@ struct BurrowWheelerAligner {
    * @param rread1 Encoded reverse-complement of read 1.
    * @param read2  Encoded forward read 2.
    * @param rread2 Encoded reverse-complement of read 2.
+   * @param insert Insert-size model for pairing and rescue.
+   * @param stats  Profile to charge counters and stage timers to.
    * @return Best paired alignment (or two SE alignments if pairing fails).
    */
   auto
   map(istring_view read1, istring_view rread1, istring_view read2,
-      istring_view rread2) const -> AlnPair {
+      istring_view rread2, const InsertSize& insert,
+      Profile& stats) const -> AlnPair {
+    stats.read_cnt += 2;
+    auto tick = Profile::clock::now();
+
     SPDLOG_DEBUG("--------------- seeding read1 ---------------");
 
-    const auto [chains1, repeats1, rrepeats1] = seeding(read1, rread1);
+    const auto [chains1, repeats1, rrepeats1] = seeding(read1, rread1, stats);
 
     SPDLOG_DEBUG("\n--------------- seeding read2 ---------------");
 
-    const auto [chains2, repeats2, rrepeats2] = seeding(read2, rread2);
+    const auto [chains2, repeats2, rrepeats2] = seeding(read2, rread2, stats);
 
     const auto frac_rep1 = (repeats1 + rrepeats1) / (read1.size() * 2.f);
     const auto frac_rep2 = (repeats2 + rrepeats2) / (read2.size() * 2.f);
+    tick = stats.lap(Profile::SEEDING, tick);
 
     auto table = std::vector<bool>(1 << args.KMER_SIZE * 2);
     const auto kmers1 = get_kmers(read1);
     const auto rkmers1 = get_kmers(rread1);
     const auto kmers2 = get_kmers(read2);
     const auto rkmers2 = get_kmers(rread2);
+    tick = stats.lap(Profile::KMER_FILTER, tick);
 
     SPDLOG_DEBUG("\n--------------- exact match read1 ---------------");
 
@@ -1061,6 +1380,9 @@ struct BurrowWheelerAligner {
     auto [alns2, sw_chains2]
       = exact_match(chains2, read2, rread2, kmers2.size());
 
+    stats.exact_match_cnt += alns1.size() + alns2.size();
+    tick = stats.lap(Profile::EXACT_MATCH, tick);
+
     SPDLOG_DEBUG("\n--------------- sw read1 ---------------");
 
     auto [sw_alns1, min_find_cnt1] = get_sw_candidates(
@@ -1075,25 +1397,39 @@ struct BurrowWheelerAligner {
     release_memory(sw_chains2);
 
     shrink_sw_size(alns1.size(), sw_alns1, alns2.size(), sw_alns2);
+    tick = stats.lap(Profile::KMER_FILTER, tick);
 
-    auto [profile1, rprofile1] = extending(alns1, sw_alns1, read1, rread1);
-    auto [profile2, rprofile2] = extending(alns2, sw_alns2, read2, rread2);
+    auto [profile1, rprofile1]
+      = extending(alns1, sw_alns1, read1, rread1, stats);
+    auto [profile2, rprofile2]
+      = extending(alns2, sw_alns2, read2, rread2, stats);
 
     release_memory(sw_alns1);
     release_memory(sw_alns2);
 
-    if (alns1.empty() && alns2.empty()) [[unlikely]]
+    drop_cross_bound(alns1, read1.size());
+    drop_cross_bound(alns2, read2.size());
+
+    if (alns1.empty() && alns2.empty()) [[unlikely]] {
+      stats.lap(Profile::EXTENDING, tick);
       return {};
+    }
 
     finalize_alns(alns1);
     finalize_alns(alns2);
+    tick = stats.lap(Profile::EXTENDING, tick);
 
     SPDLOG_DEBUG("\n************ force rescue read1 ************");
     auto rescues1 = rescue(alns2, alns1, read1, rread1, profile1, rprofile1,
-                           kmers1, rkmers1, table, min_find_cnt1);
+                           kmers1, rkmers1, table, min_find_cnt1,
+                           insert.pair_dist, stats);
     SPDLOG_DEBUG("\n************ force rescue read2 ************");
     auto rescues2 = rescue(alns1, alns2, read2, rread2, profile2, rprofile2,
-                           kmers2, rkmers2, table, min_find_cnt2);
+                           kmers2, rkmers2, table, min_find_cnt2,
+                           insert.pair_dist, stats);
+
+    drop_cross_bound(rescues1, read1.size());
+    drop_cross_bound(rescues2, read2.size());
 
     if (!rescues1.empty()) {
       std::ranges::copy(rescues1, std::back_inserter(alns1));
@@ -1112,26 +1448,202 @@ struct BurrowWheelerAligner {
     release_memory(table);
     release_memory(rescues1);
     release_memory(rescues2);
+    tick = stats.lap(Profile::RESCUE, tick);
 
+    auto aln_pair = AlnPair{};
     if (alns2.empty())
-      return {
-        get_best_one(alns1, read1, rread1, profile1, rprofile1, frac_rep1), {}};
-    if (alns1.empty())
-      return {
-        {}, get_best_one(alns2, read2, rread2, profile2, rprofile2, frac_rep2)};
-
-    SPDLOG_DEBUG("\n--------------- pairing ---------------");
-
-    auto aln_pairs = pairing2(alns1, alns2);
-    if (aln_pairs.empty()) {
-      SPDLOG_DEBUG("\n--------------- failed ---------------");
-      return {
-        get_best_one(alns1, read1, rread1, profile1, rprofile1, frac_rep1),
-        get_best_one(alns2, read2, rread2, profile2, rprofile2, frac_rep2)};
+      aln_pair.aln1 = get_best_one(alns1, read1, rread1, profile1, rprofile1,
+                                   frac_rep1, stats);
+    else if (alns1.empty())
+      aln_pair.aln2 = get_best_one(alns2, read2, rread2, profile2, rprofile2,
+                                   frac_rep2, stats);
+    else {
+      SPDLOG_DEBUG("\n--------------- pairing ---------------");
+
+      auto aln_pairs = pairing2(alns1, alns2, insert.pair_dist);
+      if (aln_pairs.empty()) {
+        SPDLOG_DEBUG("\n--------------- failed ---------------");
+        aln_pair = {get_best_one(alns1, read1, rread1, profile1, rprofile1,
+                                 frac_rep1, stats),
+                    get_best_one(alns2, read2, rread2, profile2, rprofile2,
+                                 frac_rep2, stats)};
+      } else
+        aln_pair = get_best_pair(alns1, alns2, aln_pairs, read1, rread1,
+                                 profile1, rprofile1, read2, rread2, profile2,
+                                 rprofile2, frac_rep1, frac_rep2, insert,
+                                 stats);
+    }
+    stats.lap(Profile::PAIRING, tick);
+    return aln_pair;
+  }
+
+  /**
+   * @brief Single-end mapping pipeline on an encoded read.
+   * @details Same stages as the paired pipeline without rescue and pairing.
+   * @param read  Encoded forward read.
+   * @param rread Encoded reverse-complement of the read.
+   * @param stats Profile to charge counters and stage timers to.
+   * @return Best alignment, or an empty one if the read is unmapped.
+   */
+  auto
+  map(istring_view read, istring_view rread, Profile& stats) const -> Aln {
+    stats.read_cnt++;
+    auto tick = Profile::clock::now();
+
+    SPDLOG_DEBUG("--------------- seeding read ---------------");
+
+    const auto [chains, repeats, rrepeats] = seeding(read, rread, stats);
+    const auto frac_rep = (repeats + rrepeats) / (read.size() * 2.f);
+    tick = stats.lap(Profile::SEEDING, tick);
+
+    auto table = std::vector<bool>(1 << args.KMER_SIZE * 2);
+    const auto kmers = get_kmers(read);
+    const auto rkmers = get_kmers(rread);
+    tick = stats.lap(Profile::KMER_FILTER, tick);
+
+    SPDLOG_DEBUG("\n--------------- exact match read ---------------");
+
+    auto [alns, sw_chains] = exact_match(chains, read, rread, kmers.size());
+    stats.exact_match_cnt += alns.size();
+    tick = stats.lap(Profile::EXACT_MATCH, tick);
+
+    SPDLOG_DEBUG("\n--------------- sw read ---------------");
+
+    auto sw_alns = get_sw_candidates(alns.empty(), sw_chains, read.size(),
+                                     kmers, rkmers, table).first;
+    release_memory(sw_chains);
+    if (sw_alns.size() > args.MAX_SW_CNT)
+      sw_alns.resize(args.MAX_SW_CNT);
+    if (alns.size() > args.MAX_EM_CNT)
+      sw_alns.clear();
+    tick = stats.lap(Profile::KMER_FILTER, tick);
+
+    auto [profile, rprofile] = extending(alns, sw_alns, read, rread, stats);
+    drop_cross_bound(alns, read.size());
+    if (alns.empty()) {
+      stats.lap(Profile::EXTENDING, tick);
+      return {};
+    }
+    finalize_alns(alns);
+
+    SPDLOG_DEBUG("\n************ read final result ({}) ************", alns.size());
+    print_alns(alns);
+
+    auto aln = get_best_one(alns, read, rread, profile, rprofile, frac_rep, stats);
+    stats.lap(Profile::EXTENDING, tick);
+    return aln;
+  }
+
+  /**
+   * @brief Per-mate fields shared by the SAM and BAM outputs.
+   */
+  struct MateFields {
+    std::uint16_t flag{};  ///< SAM flag.
+    std::int32_t tid = -1; ///< Contig index, -1 if unmapped.
+    std::int64_t pos = -1; ///< 0-based contig position, -1 if unmapped.
+    std::int32_t mtid = -1;///< Contig index of the mate, -1 if unmapped.
+    std::int64_t mpos = -1;///< 0-based contig position of the mate, -1 if unmapped.
+    std::int32_t tlen{};   ///< Template length.
+  };
+
+  /**
+   * @brief Marks `aln` unmapped if its final CIGAR spans two contigs.
+   * @return Contig index and contig position of `aln`; both are -1 if
+   * unmapped, as in htslib.
+   */
+  auto
+  place_aln(Aln& aln) const {
+    if (aln.score != 0 && crosses_bound(aln.pos, Cigar{aln.cigar}.ref_size()))
+      aln.score = 0, aln.mapq = 0, aln.cigar.clear();
+    const auto [chr, pos] = get_chr_pos(aln.pos);
+    auto tid = static_cast<std::int32_t>(get_chr_idx(aln.pos));
+    if (aln.score == 0 || (!chr_bounds.empty() && tid == std::ssize(chr_bounds)))
+      return std::pair{std::int32_t{-1}, std::int64_t{-1}};
+    return std::pair{tid, std::int64_t{pos}};
+  }
+
+  /**
+   * @brief Contig name of contig index `tid`, `*` if negative.
+   */
+  auto
+  get_chr_name(std::int32_t tid) const -> std::string_view {
+    if (tid < 0)
+      return "*";
+    return chr_bounds.empty() ? std::string_view{ref.name}
+                              : std::string_view{chr_bounds[tid].chrom};
+  }
+
+  /**
+   * @brief Computes flags, placements and template length of a read pair.
+   * @details Alignments spanning two contigs are marked unmapped first.
+   */
+  auto
+  get_mate_fields(Aln& aln1, Aln& aln2, const InsertSize& insert) const {
+    auto mate1 = MateFields{}, mate2 = MateFields{};
+    std::tie(mate1.tid, mate1.pos) = place_aln(aln1);
+    std::tie(mate2.tid, mate2.pos) = place_aln(aln2);
+    mate1.mtid = mate2.tid, mate1.mpos = mate2.pos;
+    mate2.mtid = mate1.tid, mate2.mpos = mate1.pos;
+
+    auto flag1 = SamUtil::READ_PAIRED + SamUtil::FIRST_OF_PAIR,
+         flag2 = SamUtil::READ_PAIRED + SamUtil::SECOND_OF_PAIR;
+    if (!aln1.forward) {
+      flag1 += SamUtil::READ_REVERSE_STRAND;
+      flag2 += SamUtil::MATE_REVERSE_STRAND;
+    }
+    if (!aln2.forward) {
+      flag1 += SamUtil::MATE_REVERSE_STRAND;
+      flag2 += SamUtil::READ_REVERSE_STRAND;
+    }
+    if (aln1.score == 0) {
+      flag1 += SamUtil::READ_UNMAPPED;
+      flag2 += SamUtil::MATE_UNMAPPED;
     }
-    return get_best_pair(alns1, alns2, aln_pairs, read1, rread1, profile1,
-                         rprofile1, read2, rread2, profile2, rprofile2,
-                         frac_rep1, frac_rep2);
+    if (aln2.score == 0) {
+      flag1 += SamUtil::MATE_UNMAPPED;
+      flag2 += SamUtil::READ_UNMAPPED;
+    }
+    if (aln1.score != 0 && aln2.score != 0 && mate1.tid == mate2.tid) {
+      mate1.tlen = SamUtil::compute_tlen(mate1.pos, aln1.cigar, aln1.forward,
+                                         mate2.pos, aln2.cigar, aln2.forward);
+      mate2.tlen = -mate1.tlen;
+      if (aln1.forward != aln2.forward
+          && std::abs(mate1.tlen) <= insert.pair_dist) {
+        flag1 += SamUtil::PROPER_PAIR;
+        flag2 += SamUtil::PROPER_PAIR;
+      }
+    }
+    mate1.flag = flag1, mate2.flag = flag2;
+    return std::pair{mate1, mate2};
+  }
+
+  /**
+   * @brief Fills `record` from a placed alignment, packing the sequence in
+   * alignment orientation.
+   */
+  auto
+  fill_bam(BamRecord& record, std::string_view qname, const MateFields& mate,
+           const Aln& aln, std::string_view seq, std::string_view qual) const {
+    record.clear();
+    record.tid = mate.tid;
+    record.pos = mate.pos;
+    record.mapq = aln.mapq;
+    record.flag = mate.flag;
+    record.mtid = mate.mtid;
+    record.mpos = mate.mpos;
+    record.isize = mate.tlen;
+    record.append_qname(qname);
+    record.append_cigar(aln.cigar);
+    if (aln.forward)
+      record.append_seq(seq);
+    else
+      record.append_seq(aln.rev_comp);
+    record.append_qual(qual, !aln.forward);
+    record.append_aux("AS", aln.score);
+    record.append_aux("XS", aln.sub_score);
+    record.append_aux("RG", "1");
+    if (aln.rescued)
+      record.append_aux("rs", 1);
   }
 
  public:
@@ -1139,97 +1651,107 @@ struct BurrowWheelerAligner {
    * @brief Map two ASCII reads (A/C/G/T) by converting to internal encoding.
    * @param read1 Read 1 sequence as ASCII string.
    * @param read2 Read 2 sequence as ASCII string.
+   * @param insert Insert-size model for pairing and rescue.
+   * @param stats Profile to charge counters and stage timers to.
    * @return Pair of @ref Aln for read1 and read2.
    * @details Convenience wrapper that performs encoding and calls the internal pipeline.
    */
   auto
-  map(std::string_view read1, std::string_view read2) const {
+  map(std::string_view read1, std::string_view read2, const InsertSize& insert,
+      Profile& stats) const {
     auto iread1 = Codec::to_istring(read1);
     auto iread2 = Codec::to_istring(read2);
     auto riread1 = Codec::rev_comp(iread1);
     auto riread2 = Codec::rev_comp(iread2);
-    auto [aln1, aln2] = map(iread1, riread1, iread2, riread2);
+    auto [aln1, aln2] = map(iread1, riread1, iread2, riread2, insert, stats);
     aln1.rev_comp = std::move(riread1);
     aln2.rev_comp = std::move(riread2);
     return std::pair{std::move(aln1), std::move(aln2)};
   }
 
+  /**
+   * @brief Same as above, with the insert-size prior of @ref Parameters.
+   */
+  auto
+  map(std::string_view read1, std::string_view read2, Profile& stats) const {
+    return map(read1, read2, default_insert_size(), stats);
+  }
+
+  /**
+   * @brief Same as above, without profiling.
+   */
+  auto
+  map(std::string_view read1, std::string_view read2) const {
+    auto stats = Profile{};
+    return map(read1, read2, stats);
+  }
+
+  /**
+   * @brief Map a single-end ASCII read; no pairing or rescue is done.
+   * @param read Read sequence as ASCII string.
+   * @param stats Profile to charge counters and stage timers to.
+   * @return @ref Aln of the read (score 0 if unmapped).
+   */
+  auto
+  map(std::string_view read, Profile& stats) const {
+    auto iread = Codec::to_istring(read);
+    auto riread = Codec::rev_comp(iread);
+    auto aln = map(iread, riread, stats);
+    aln.rev_comp = std::move(riread);
+    return aln;
+  }
+
+  /**
+   * @brief Same as above, without profiling.
+   */
+  auto
+  map(std::string_view read) const {
+    auto stats = Profile{};
+    return map(read, stats);
+  }
+
   /**
    * @brief Align paired-end FASTQ reads and produce SAM records.
    * @param read Pair of FASTQ records (first = read1, second = read2).
+   * @param insert Insert-size model for pairing, rescue and proper-pair flag.
+   * @param stats Profile to charge counters and stage timers to.
    * @return Pair of @ref SamRecord entries (for read1, read2).
    * @details
    *  - Computes SAM flags (paired, strand, proper-pair), 1-based positions, MAPQ, and CIGAR.
+   *  - Reports RNAME/POS per contig when `chr_bounds` is set; an alignment
+   *    whose final CIGAR spans two contigs is reported as unmapped.
    *  - Emits '=' for RNEXT when both mates map to the same reference contig.
    *  - Adds optional tags: `AS` (best score), `XS` (suboptimal), `RG`, and rescue tag `rs:i:1`.
    *  - Outputs '*' and unmapped flags when an alignment is missing.
    */
   auto
-  generate_sam(const std::pair<FastqRecord<>, FastqRecord<>>& read) const {
+  generate_sam(const std::pair<FastqRecord<>, FastqRecord<>>& read,
+               const InsertSize& insert, Profile& stats) const {
     const auto& name = read.first.name;
     const auto& read1 = read.first.seq;
     const auto& qual1 = read.first.qual;
     const auto& read2 = read.second.seq;
     const auto& qual2 = read.second.qual;
 
-    const auto [aln1, aln2] = map(read1, read2);
-    auto [gpos1, score1, score21, forward1, read_end1, ref_end1, find_cnt1,
-          align_len1, mapq1, sub_score1, rescued1, cigar1, riread1]
+    auto [aln1, aln2] = map(read1, read2, insert, stats);
+    const auto tick = Profile::clock::now();
+    const auto [mate1, mate2] = get_mate_fields(aln1, aln2, insert);
+    auto& [gpos1, score1, score21, forward1, read_end1, ref_end1, find_cnt1,
+           align_len1, mapq1, sub_score1, rescued1, cigar1, riread1]
       = aln1;
-    auto [gpos2, score2, score22, forward2, read_end2, ref_end2, find_cnt2,
-          align_len2, mapq2, sub_score2, rescued2, cigar2, riread2]
+    auto& [gpos2, score2, score22, forward2, read_end2, ref_end2, find_cnt2,
+           align_len2, mapq2, sub_score2, rescued2, cigar2, riread2]
       = aln2;
     if (cigar1.empty())
       cigar1 = "*";
     if (cigar2.empty())
       cigar2 = "*";
-    // flag1
 
-    auto flag1 = SamUtil::READ_PAIRED + SamUtil::FIRST_OF_PAIR,
-         flag2 = SamUtil::READ_PAIRED + SamUtil::SECOND_OF_PAIR;
-    if (!forward1) {
-      flag1 += SamUtil::READ_REVERSE_STRAND;
-      flag2 += SamUtil::MATE_REVERSE_STRAND;
-    }
-    if (!forward2) {
-      flag1 += SamUtil::MATE_REVERSE_STRAND;
-      flag2 += SamUtil::READ_REVERSE_STRAND;
-    }
-    // for WGS:
-    // auto [chr1, pos1] = Hs37d5::get_chr_pos(gpos1);
-    // auto [chr2, pos2] = Hs37d5::get_chr_pos(gpos2);
-    // for single chr
-    auto chr = ref.name;
-    auto pos1 = gpos1;
-    auto pos2 = gpos2;
-    auto rname1 = std::string{chr};
-    auto rname2 = std::string{chr};
-    if (score1 == 0) {
-      flag1 += SamUtil::READ_UNMAPPED;
-      flag2 += SamUtil::MATE_UNMAPPED;
-      rname1 = "*";
-    }
-    if (score2 == 0) {
-      flag1 += SamUtil::MATE_UNMAPPED;
-      flag2 += SamUtil::READ_UNMAPPED;
-      rname2 = "*";
-    }
-    auto rnext1 = rname2, rnext2 = rname1;
-    auto pnext1 = pos2, pnext2 = pos1;
-    auto tlen1 = 0, tlen2 = 0;
-    auto proper_pair = false;
-    if (score1 != 0 && score2 != 0 && rname1 == rname2) {
-      rnext1 = "=";
-      rnext2 = "=";
-      tlen1
-        = SamUtil::compute_tlen(pos1, cigar1, forward1, pos2, cigar2, forward2);
-      tlen2 = -tlen1;
-      if (forward1 != forward2 && std::abs(tlen1) <= args.PAIR_DIST) {
-        flag1 += SamUtil::PROPER_PAIR;
-        flag2 += SamUtil::PROPER_PAIR;
-        proper_pair = true;
-      }
-    }
+    const auto rname1 = std::string{get_chr_name(mate1.tid)};
+    const auto rname2 = std::string{get_chr_name(mate2.tid)};
+    const auto same_chr = score1 != 0 && score2 != 0 && mate1.tid == mate2.tid;
+    const auto rnext1 = same_chr ? std::string{"="} : rname2;
+    const auto rnext2 = same_chr ? std::string{"="} : rname1;
 
     const auto qname = name.substr(0, name.find_first_of(" \t"));
     auto optionals1 = std::vector<std::string>{
@@ -1242,14 +1764,14 @@ struct BurrowWheelerAligner {
       = SamRecord{{},  // for base
                   nullptr,
                   qname,
-                  static_cast<std::uint16_t>(flag1),
+                  mate1.flag,
                   rname1,
-                  pos1 + 1,
+                  static_cast<std::uint32_t>(mate1.pos + 1),
                   mapq1,
                   cigar1,
                   rnext1,
-                  pos2 + 1,
-                  tlen1,
+                  static_cast<std::uint32_t>(mate1.mpos + 1),
+                  mate1.tlen,
                   forward1 ? read1 : Codec::to_string(riread1),
                   forward1 ? qual1 : std::string{qual1.rbegin(), qual1.rend()},
                   std::move(optionals1)};
@@ -1258,20 +1780,233 @@ struct BurrowWheelerAligner {
       = SamRecord{{},
                   nullptr,
                   qname,
-                  static_cast<std::uint16_t>(flag2),
+                  mate2.flag,
                   rname2,
-                  pos2 + 1,
+                  static_cast<std::uint32_t>(mate2.pos + 1),
                   mapq2,
                   cigar2,
                   rnext2,
-                  pos1 + 1,
-                  tlen2,
+                  static_cast<std::uint32_t>(mate2.mpos + 1),
+                  mate2.tlen,
                   forward2 ? read2 : Codec::to_string(riread2),
                   forward2 ? qual2 : std::string{qual2.rbegin(), qual2.rend()},
                   std::move(optionals2)};
 
+    stats.lap(Profile::GENERATE_SAM, tick);
     return std::pair{std::move(record1), std::move(record2)};
   }
+
+  /**
+   * @brief Same as above, with the insert-size prior of @ref Parameters.
+   */
+  auto
+  generate_sam(const std::pair<FastqRecord<>, FastqRecord<>>& read,
+               Profile& stats) const {
+    return generate_sam(read, default_insert_size(), stats);
+  }
+
+  /**
+   * @brief Same as above, without profiling.
+   */
+  auto
+  generate_sam(const std::pair<FastqRecord<>, FastqRecord<>>& read) const {
+    auto stats = Profile{};
+    return generate_sam(read, stats);
+  }
+
+  /**
+   * @brief Align paired-end FASTQ reads straight into packed BAM records.
+   * @param read Pair of FASTQ records (first = read1, second = read2).
+   * @param records Output records, cleared and refilled; reusing them
+   * across calls avoids reallocating their buffers.
+   * @param insert Insert-size model for pairing, rescue and proper-pair flag.
+   * @param stats Profile to charge counters and stage timers to.
+   * @details Same fields and tags as @ref generate_sam, without building
+   * the SAM text. `tid`/`mtid` index `chr_bounds` (0 for a single-contig
+   * reference), so the BAM header must list the contigs in that order.
+   */
+  auto
+  generate_bam(const std::pair<FastqRecord<>, FastqRecord<>>& read,
+               std::pair<BamRecord, BamRecord>& records,
+               const InsertSize& insert, Profile& stats) const {
+    const auto& name = read.first.name;
+    auto [aln1, aln2] = map(read.first.seq, read.second.seq, insert, stats);
+    const auto tick = Profile::clock::now();
+    const auto [mate1, mate2] = get_mate_fields(aln1, aln2, insert);
+    const auto qname = std::string_view{name}.substr(0, name.find_first_of(" \t"));
+    fill_bam(records.first, qname, mate1, aln1, read.first.seq, read.first.qual);
+    fill_bam(records.second, qname, mate2, aln2, read.second.seq,
+             read.second.qual);
+    stats.lap(Profile::GENERATE_SAM, tick);
+  }
+
+  /**
+   * @brief Same as above, with the insert-size prior of @ref Parameters.
+   */
+  auto
+  generate_bam(const std::pair<FastqRecord<>, FastqRecord<>>& read,
+               std::pair<BamRecord, BamRecord>& records, Profile& stats) const {
+    generate_bam(read, records, default_insert_size(), stats);
+  }
+
+  /**
+   * @brief Same as above, without profiling.
+   */
+  auto
+  generate_bam(const std::pair<FastqRecord<>, FastqRecord<>>& read,
+               std::pair<BamRecord, BamRecord>& records) const {
+    auto stats = Profile{};
+    generate_bam(read, records, stats);
+  }
+
+  /**
+   * @brief Align a batch of read pairs with online insert-size estimation.
+   * @details
+   * The first INSERT_SAMPLE_CNT pairs are aligned with @p insert. Pairs
+   * whose mates both reach INSERT_MAPQ on opposite strands of the same
+   * contig are sampled, and if there are at least MIN_INSERT_SAMPLE_CNT
+   * of them the rest of the batch is aligned with the estimated insert
+   * size (see @ref estimate_insert_size).
+   * @param reads Read pairs of the batch.
+   * @param insert Insert-size prior; updated to the estimate, if any.
+   * @param stats Profile to charge counters and stage timers to.
+   * @return SAM record pairs, in input order.
+   */
+  auto
+  generate_sam_batch(std::span<const std::pair<FastqRecord<>, FastqRecord<>>> reads,
+                     InsertSize& insert, Profile& stats) const {
+    auto records = std::vector<std::pair<SamRecord<>, SamRecord<>>>{};
+    records.reserve(reads.size());
+
+    const auto sample_cnt
+      = std::min(reads.size(), static_cast<std::size_t>(args.INSERT_SAMPLE_CNT));
+    auto dists = std::vector<int>{};
+    for (const auto& read : reads.first(sample_cnt)) {
+      auto& [rec1, rec2] = records.emplace_back(generate_sam(read, insert, stats));
+      if (rec1.mapq >= args.INSERT_MAPQ && rec2.mapq >= args.INSERT_MAPQ
+          && rec1.rnext == "="
+          && !(rec1.flag & SamUtil::READ_REVERSE_STRAND)
+               != !(rec2.flag & SamUtil::READ_REVERSE_STRAND))
+        dists.push_back(std::abs(rec1.tlen));
+    }
+    if (const auto estimated = estimate_insert_size(std::move(dists))) {
+      SPDLOG_DEBUG("insert size: {} +- {} (pair dist: {})", estimated->mean,
+                   estimated->var, estimated->pair_dist);
+      insert = *estimated;
+    }
+
+    for (const auto& read : reads.subspan(sample_cnt))
+      records.push_back(generate_sam(read, insert, stats));
+    return records;
+  }
+
+  /**
+   * @brief Same as above, starting from the insert-size prior of
+   * @ref Parameters.
+   */
+  auto
+  generate_sam_batch(std::span<const std::pair<FastqRecord<>, FastqRecord<>>> reads,
+                     Profile& stats) const {
+    auto insert = default_insert_size();
+    return generate_sam_batch(reads, insert, stats);
+  }
+
+  /**
+   * @brief Align a single-end FASTQ read and produce a SAM record.
+   * @param read FASTQ record.
+   * @param stats Profile to charge counters and stage timers to.
+   * @return @ref SamRecord of the read.
+   * @details
+   *  - Computes SAM flag (strand/unmapped), 1-based position, MAPQ and CIGAR.
+   *  - Adds optional tags: `AS` (best score), `XS` (suboptimal) and `RG`.
+   */
+  auto
+  generate_sam(const FastqRecord<>& read, Profile& stats) const {
+    const auto& name = read.name;
+    const auto& seq = read.seq;
+    const auto& qual = read.qual;
+
+    auto [gpos, score, score2, forward, read_end, ref_end, find_cnt, align_len,
+          mapq, sub_score, rescued, cigar, riread]
+      = map(seq, stats);
+    const auto tick = Profile::clock::now();
+
+    if (score != 0 && crosses_bound(gpos, Cigar{cigar}.ref_size()))
+      score = 0, mapq = 0, cigar.clear();
+    if (cigar.empty())
+      cigar = "*";
+
+    auto flag = 0;
+    if (!forward)
+      flag += SamUtil::READ_REVERSE_STRAND;
+    const auto [chr, pos] = get_chr_pos(gpos);
+    auto rname = std::string{chr};
+    if (score == 0) {
+      flag += SamUtil::READ_UNMAPPED;
+      rname = "*";
+    }
+
+    auto record = SamRecord{{},
+                            nullptr,
+                            name.substr(0, name.find_first_of(" \t")),
+                            static_cast<std::uint16_t>(flag),
+                            std::move(rname),
+                            score == 0 ? 0 : pos + 1,
+                            mapq,
+                            cigar,
+                            "*",
+                            0,
+                            0,
+                            forward ? seq : Codec::to_string(riread),
+                            forward ? qual : std::string{qual.rbegin(), qual.rend()},
+                            {"AS:i:" + std::to_string(score),
+                             "XS:i:" + std::to_string(sub_score), "RG:Z:1"}};
+
+    stats.lap(Profile::GENERATE_SAM, tick);
+    return record;
+  }
+
+  /**
+   * @brief Same as above, without profiling.
+   */
+  auto
+  generate_sam(const FastqRecord<>& read) const {
+    auto stats = Profile{};
+    return generate_sam(read, stats);
+  }
+
+  /**
+   * @brief Align a single-end FASTQ read straight into a packed BAM record.
+   * @param read FASTQ record.
+   * @param record Output record, cleared and refilled.
+   * @param stats Profile to charge counters and stage timers to.
+   * @details Same fields and tags as the single-end @ref generate_sam.
+   */
+  auto
+  generate_bam(const FastqRecord<>& read, BamRecord& record,
+               Profile& stats) const {
+    const auto& name = read.name;
+    auto aln = map(read.seq, stats);
+    const auto tick = Profile::clock::now();
+    auto mate = MateFields{};
+    std::tie(mate.tid, mate.pos) = place_aln(aln);
+    if (!aln.forward)
+      mate.flag += SamUtil::READ_REVERSE_STRAND;
+    if (aln.score == 0)
+      mate.flag += SamUtil::READ_UNMAPPED;
+    fill_bam(record, std::string_view{name}.substr(0, name.find_first_of(" \t")),
+             mate, aln, read.seq, read.qual);
+    stats.lap(Profile::GENERATE_SAM, tick);
+  }
+
+  /**
+   * @brief Same as above, without profiling.
+   */
+  auto
+  generate_bam(const FastqRecord<>& read, BamRecord& record) const {
+    auto stats = Profile{};
+    generate_bam(read, record, stats);
+  }
 };
 
 }  // namespace biovoltron
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <biovoltron/applications/haplotypecaller/genotype/reference_confidence_model/reference_confidence_model.hpp>
+#include <biovoltron/file_io/sam.hpp>
+#include <biovoltron/math/math_utils.hpp>
+#include <biovoltron/utility/interval.hpp>
+
+namespace biovoltron {
+
+/**
+ * Per-base probability that a site is not homozygous reference, from the
+ * mismatches, indels and soft clips of the reads piled up on it. Used to
+ * skip assembly on windows that look like the reference. The pileups
+ * also give the reference confidence of GVCF blocks.
+ */
+struct ActivityProfile {
+  constexpr static auto MIN_BASE_QUAL = ReferenceConfidenceModel::MIN_BASE_QUAL;
+  constexpr static auto EVENT_QUAL = ReferenceConfidenceModel::REF_MODEL_DELETION_QUAL;
+  constexpr static auto HETEROZYGOSITY = 0.001;
+
+  /**
+   * Reference versus any non-reference genotype likelihoods of a base,
+   * unnormalized, and the number of pileup elements behind them.
+   */
+  struct Pileup {
+    std::array<double, 3> genotype_likelihoods{};
+    std::uint32_t depth{};
+  };
+
+  /**
+   * Pile the reads up on each base of region.
+   *
+   * @param reads Reads with their original (unclipped) alignments, or
+   * pointers to them.
+   * @param ref Reference sequence of ref_region.
+   * @param ref_region Reference region covered by ref.
+   * @param region Region to pile up, within ref_region.
+   * @return Pileup of each base of region.
+   */
+  static auto
+  pileup(const auto& reads, std::string_view ref,
+         const Interval& ref_region, const Interval& region) {
+    auto pileups = std::vector<Pileup>(region.size());
+    const auto ref_end = std::min<std::uint32_t>(region.end, ref_region.begin + ref.size());
+    const auto add = [&](std::uint32_t pos, ichar read_base, ichar qual) {
+      if (pos < region.begin || pos >= ref_end)
+        return;
+      auto& pileup = pileups[pos - region.begin];
+      ReferenceConfidenceModel::apply_pileup_element_ref_vs_non_ref_likelihood_and_count(
+        Codec::to_int(ref[pos - ref_region.begin]),
+        pileup.genotype_likelihoods, read_base, qual);
+      pileup.depth++;
+    };
+    // Indels and clips are non-reference evidence at the site they touch.
+    const auto add_event = [&](std::uint32_t pos) {
+      add(pos, NON_REF, EVENT_QUAL);
+    };
+
+    for (const auto& element : reads) {
+      const auto& read = as_record(element);
+      const auto has_qual = read.qual.size() == read.seq.size();
+      auto pos = read.begin();
+      auto read_pos = std::uint32_t{};
+      for (const auto [size, op] : read.cigar) {
+        switch (op) {
+          case 'M':
+          case '=':
+          case 'X':
+            for (auto i = 0u; i < size; i++) {
+              const auto qual = has_qual ? read.qual[read_pos + i] - 33 : 0;
+              if (qual >= MIN_BASE_QUAL)
+                add(pos + i, Codec::to_int(read.seq[read_pos + i]), qual);
+            }
+            pos += size;
+            read_pos += size;
+            break;
+          case 'I':
+            add_event(pos);
+            read_pos += size;
+            break;
+          case 'S':
+            add_event(read_pos == 0 ? pos : pos - 1);
+            read_pos += size;
+            break;
+          case 'D':
+            for (auto i = 0u; i < size; i++) add_event(pos + i);
+            pos += size;
+            break;
+          case 'N':
+            pos += size;
+            break;
+        }
+      }
+    }
+    return pileups;
+  }
+
+  /**
+   * Compute the activity of each base of region.
+   *
+   * @param reads Reads with their original (unclipped) alignments.
+   * @param ref Reference sequence of ref_region.
+   * @param ref_region Reference region covered by ref.
+   * @param region Region to profile, within ref_region.
+   * @return Probability of a non hom-ref genotype for each base of region.
+   */
+  static auto
+  compute(const auto& reads, std::string_view ref,
+          const Interval& ref_region, const Interval& region) {
+    const auto priors = std::array{std::log10(1 - 1.5 * HETEROZYGOSITY),
+                                   std::log10(HETEROZYGOSITY),
+                                   std::log10(HETEROZYGOSITY / 2)};
+    auto activity = std::vector<double>{};
+    const auto pileups = pileup(reads, ref, ref_region, region);
+    activity.reserve(pileups.size());
+    for (auto [genotype_likelihoods, depth] : pileups) {
+      for (auto i = 0; i < 3; i++) genotype_likelihoods[i] += priors[i];
+      const auto posteriors
+        = MathUtils::normalize_from_log10_to_linear_space(genotype_likelihoods);
+      activity.push_back(1 - posteriors[0]);
+    }
+    return activity;
+  }
+
+  /**
+   * Whether any base of region reaches the activity threshold.
+   */
+  static auto
+  is_active(const auto& reads, std::string_view ref,
+            const Interval& ref_region, const Interval& region,
+            double threshold) {
+    return std::ranges::any_of(compute(reads, ref, ref_region, region),
+                               [&](auto p) { return p >= threshold; });
+  }
+
+ private:
+  // Differs from every reference base, N included.
+  constexpr static auto NON_REF = ichar{-1};
+
+  static auto&
+  as_record(const SamRecord<>& read) {
+    return read;
+  }
+
+  static auto&
+  as_record(const SamRecord<>* read) {
+    return *read;
+  }
+};
+
+}  // namespace biovoltron
@@ -20,17 +20,20 @@ struct AFCalculator {
     std::span<const double> log10_genotype_likelihoods,
     std::span<const double> log10_allele_frequencies,
     std::span<const Genotype> genotypes) {
+    const auto log10_heterozygous_combination_count = std::log10(2);
     auto log10_posteriors = std::vector(genotypes.size(), 0.0);
     for (auto i = 0; i < log10_posteriors.size(); i++) {
       const auto [allele1, allele2] = genotypes[i];
       const auto log10_combination_count
-        = allele1 == allele2 ? 0 : std::log10(2);
+        = allele1 == allele2 ? 0 : log10_heterozygous_combination_count;
       const auto sum
         = log10_allele_frequencies[allele1] + log10_allele_frequencies[allele2];
       log10_posteriors[i]
         = log10_combination_count + log10_genotype_likelihoods[i] + sum;
     }
-    return MathUtils::normalize_log10(log10_posteriors);
+    const auto log10_sum = MathUtils::log10_sum_log10(log10_posteriors);
+    for (auto& log10_posterior : log10_posteriors) log10_posterior -= log10_sum;
+    return log10_posteriors;
   }
 
   static auto
@@ -110,8 +113,6 @@ struct AFCalculator {
 
     auto log10p_of_zero_counts_by_allele = std::vector(num_alleles, 0.0);
     auto log10p_no_variant = 0.0;
-    auto log10_absent_posteriors
-      = std::vector<std::vector<double>>(num_alleles);
     if (std::ranges::find(alleles, SPAN_DEL) == alleles.end())
       log10p_no_variant += log10_genotype_posteriors[HOM_REF_GENOTYPE_INDEX];
     else {
@@ -127,21 +128,18 @@ struct AFCalculator {
     }
 
     if (num_alleles != 2) {
-      for (auto i = 0; i < genotypes.size(); i++) {
-        const auto log10_genotype_posterior = log10_genotype_posteriors[i];
-        const auto [allele1, allele2] = genotypes[i];
-        for (auto n = 0; n < log10_absent_posteriors.size(); n++)
-          if (n != allele1 && n != allele2)
-            log10_absent_posteriors[n].push_back(log10_genotype_posterior);
+      // Posteriors of the genotypes without allele n, reused across alleles.
+      auto log10_absent_posteriors = std::vector<double>{};
+      log10_absent_posteriors.reserve(genotypes.size());
+      for (auto n = 0; n < num_alleles; n++) {
+        log10_absent_posteriors.clear();
+        for (auto i = 0; i < genotypes.size(); i++)
+          if (const auto [allele1, allele2] = genotypes[i];
+              n != allele1 && n != allele2)
+            log10_absent_posteriors.push_back(log10_genotype_posteriors[i]);
+        log10p_of_zero_counts_by_allele[n] += std::min(
+          0.0, MathUtils::log10_sum_log10(log10_absent_posteriors));
       }
-
-      auto log10p_no_allele = std::vector<double>{};
-      for (const auto& buffer : log10_absent_posteriors)
-        log10p_no_allele.push_back(
-          std::min(0.0, MathUtils::log10_sum_log10(buffer)));
-
-      for (auto i = 0; i < log10p_of_zero_counts_by_allele.size(); i++)
-        log10p_of_zero_counts_by_allele[i] += log10p_no_allele[i];
     }
 
     if (num_alleles == 2)
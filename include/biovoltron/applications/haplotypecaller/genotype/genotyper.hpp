@@ -15,6 +15,7 @@ namespace biovoltron {
 
 class Genotyper {
   static inline const auto SPAN_DEL = std::string{"*"};
+  static inline const auto NON_REF = std::string{"<NON_REF>"};
   static constexpr auto ALLELE_EXTENSION = 2;
   static constexpr auto MAX_ALLELE_COUNT = GenotypeUtils::MAX_ALLELE_COUNT;
   constexpr static auto STANDARD_CONFIDENCE_FOR_CALLING = 30.0;
@@ -219,23 +220,26 @@ class Genotyper {
     return read_indices_to_keep;
   }
 
+  /**
+   * Likelihoods of the kept reads given each allele, the best of the
+   * haplotypes carrying it. Stored allele-major, each allele's likelihoods
+   * over the reads contiguous, for calculate_genotype_likelihoods.
+   */
   auto
   marginal_likelihoods(
     std::uint32_t allele_count,
     const std::vector<std::uint32_t>& haplotype_mapper,
     const std::vector<std::uint32_t>& read_indices_to_keep,
     const std::vector<std::vector<double>>& haplotype_likelihoods) const {
+    const auto read_count = read_indices_to_keep.size();
     auto allele_likelihoods = std::vector(
-      read_indices_to_keep.size(),
-      std::vector(allele_count, std::numeric_limits<double>::lowest()));
-    for (auto r = 0; r < read_indices_to_keep.size(); r++) {
-      const auto old_read_index = read_indices_to_keep[r];
-      for (auto h = 0; h < haplotype_mapper.size(); h++) {
-        const auto allele_index = haplotype_mapper[h];
-        const auto likelihood = haplotype_likelihoods[old_read_index][h];
-        if (likelihood > allele_likelihoods[r][allele_index])
-          allele_likelihoods[r][allele_index] = likelihood;
-      }
+      allele_count * read_count, std::numeric_limits<double>::lowest());
+    for (auto h = 0; h < haplotype_mapper.size(); h++) {
+      const auto likelihoods = std::span{allele_likelihoods}.subspan(
+        haplotype_mapper[h] * read_count, read_count);
+      for (auto r = 0; r < read_count; r++)
+        likelihoods[r] = std::max(
+          likelihoods[r], haplotype_likelihoods[read_indices_to_keep[r]][h]);
     }
     return allele_likelihoods;
   }
@@ -250,79 +254,75 @@ class Genotyper {
                                 read_indices_to_keep, haplotype_likelihoods);
   }
 
+  /**
+   * Log10 likelihoods of the genotypes in raw order, each the sum over the
+   * reads of the read's likelihood given the genotype's two alleles.
+   */
   auto
-  single_component_genotype_likelihood_by_read(
-    std::vector<double>& genotype_likelihoods,
-    const std::vector<std::vector<double>>& allele_likelihoods,
-    std::uint32_t a) const {
+  calculate_genotype_likelihoods(const std::vector<double>& allele_likelihoods,
+                                 std::uint32_t allele_count) const {
+    const auto read_count = allele_likelihoods.size() / allele_count;
+    const auto by_allele = [&](std::uint32_t allele) {
+      return std::span{allele_likelihoods}.subspan(allele * read_count,
+                                                   read_count);
+    };
     const auto log10_frequency = std::log10(2);
-    std::ranges::transform(allele_likelihoods,
-                           std::back_inserter(genotype_likelihoods),
-                           [=](const auto& likelihoods) {
-                             return likelihoods[a] + log10_frequency;
-                           });
-  }
-
-  auto
-  two_component_genotype_likelihood_by_read(
-    std::vector<double>& genotype_likelihoods,
-    const std::vector<std::vector<double>>& allele_likelihoods,
-    std::uint32_t a1, std::uint32_t a2) const {
-    std::ranges::transform(allele_likelihoods,
-                           std::back_inserter(genotype_likelihoods),
-                           [=](const auto& likelihoods) {
-                             return MathUtils::approximate_log10_sum_log10(
-                               likelihoods[a1], likelihoods[a2]);
-                           });
-  }
-
-  auto
-  calculate_read_likelihoods_by_genotype_index(
-    const std::vector<std::vector<double>>& allele_likelihoods,
-    std::uint32_t allele_count) const {
-    auto read_likelihoods_by_genotype_index = std::vector(
-      (allele_count + 1) * allele_count / 2, std::vector<double>{});
-    auto cur_genotype_index = 0;
-    for (auto a1 = 0; a1 < allele_count; a1++) {
-      for (auto a2 = a1; a2 < allele_count; a2++) {
-        auto& read_genotype_likelihoods
-          = read_likelihoods_by_genotype_index[cur_genotype_index++];
-        read_genotype_likelihoods.reserve(allele_likelihoods.size());
-        if (a1 == a2)
-          single_component_genotype_likelihood_by_read(
-            read_genotype_likelihoods, allele_likelihoods, a1);
-        else
-          two_component_genotype_likelihood_by_read(read_genotype_likelihoods,
-                                                    allele_likelihoods, a1, a2);
-      }
-    }
-    return read_likelihoods_by_genotype_index;
-  }
-
-  auto
-  get_genotype_likelihoods(const std::vector<std::vector<double>>&
-                             read_likelihoods_by_genotype_index) const {
-    const auto genotype_count = read_likelihoods_by_genotype_index.size();
-    auto result = std::vector(genotype_count, 0.0);
-    const auto denominator
-      = read_likelihoods_by_genotype_index[0].size() * std::log10(2);
-    for (auto genotype = 0; genotype < genotype_count; genotype++)
+    const auto denominator = read_count * log10_frequency;
+
+    const auto genotypes = GenotypeUtils::get_raw_genotypes(allele_count);
+    auto result = std::vector(genotypes.size(), 0.0);
+    auto read_likelihoods = std::vector(read_count, 0.0);
+    for (auto genotype = 0; genotype < genotypes.size(); genotype++) {
+      const auto [a1, a2] = genotypes[genotype];
+      if (a1 == a2)
+        std::ranges::transform(
+          by_allele(a1), read_likelihoods.begin(),
+          [=](auto likelihood) { return likelihood + log10_frequency; });
+      else
+        MathUtils::approximate_log10_sum_log10(by_allele(a1), by_allele(a2),
+                                               read_likelihoods);
       result[genotype]
-        = std::accumulate(read_likelihoods_by_genotype_index[genotype].begin(),
-                          read_likelihoods_by_genotype_index[genotype].end(),
-                          0.0)
+        = std::accumulate(read_likelihoods.begin(), read_likelihoods.end(), 0.0)
           - denominator;
+    }
     return result;
   }
 
+  // Append <NON_REF> to the alleles of a called variant and replace its
+  // PLs with those of the genotypes over its alleles and <NON_REF>. A
+  // read's likelihood given <NON_REF> is the median of its likelihoods
+  // given the alleles other than its best one, so the PLs weigh the
+  // called alleles against any other. GT and GQ are taken from the new
+  // PLs, so that the record agrees with its PL field.
   auto
-  calculate_genotype_likelihoods(
-    const std::vector<std::vector<double>>& allele_likelihoods,
-    std::uint32_t allele_count) const {
-    const auto read_likelihoods_by_genotype_index
-      = calculate_read_likelihoods_by_genotype_index(allele_likelihoods,
-                                                     allele_count);
-    return get_genotype_likelihoods(read_likelihoods_by_genotype_index);
+  add_non_ref(Variant& variant, std::span<const std::string> alleles,
+              const std::vector<double>& allele_likelihoods) const -> void {
+    const auto read_count = allele_likelihoods.size() / alleles.size();
+    const auto kept_count = variant.alleles.size();
+    auto likelihoods = std::vector<double>((kept_count + 1) * read_count);
+    for (auto a = 0u; a < kept_count; a++)
+      std::ranges::copy(
+        std::span{allele_likelihoods}.subspan(
+          RangeUtils::index_of(alleles, variant.alleles[a]) * read_count,
+          read_count),
+        likelihoods.begin() + a * read_count);
+
+    auto others = std::vector<double>(alleles.size());
+    for (auto r = 0u; r < read_count; r++) {
+      for (auto a = 0u; a < alleles.size(); a++)
+        others[a] = allele_likelihoods[a * read_count + r];
+      std::ranges::sort(others, std::ranges::greater{});
+      const auto rest = std::span{others}.subspan(1);
+      likelihoods[kept_count * read_count + r]
+        = (rest[(rest.size() - 1) / 2] + rest[rest.size() / 2]) / 2;
+    }
+
+    variant.pls = GenotypeUtils::gls_to_pls(GenotypeUtils::to_vcf_order(
+      calculate_genotype_likelihoods(likelihoods, kept_count + 1)));
+    variant.gt = GenotypeUtils::get_vcf_genotypes(kept_count + 1)[
+      std::ranges::min_element(variant.pls) - variant.pls.begin()];
+    variant.gq = RangeUtils::second<std::ranges::less>(variant.pls);
+    variant.alleles.push_back(NON_REF);
   }
 
   static auto
@@ -394,7 +394,7 @@ class Genotyper {
     const std::vector<SamRecord<>>& reads, std::vector<Haplotype>& haplotypes,
     const std::vector<std::vector<double>>& haplotype_likelihoods,
     std::string_view ref, const Interval& padded_region,
-    const Interval& origin_region) const {
+    const Interval& origin_region, bool non_ref = false) const {
     const auto events_begins
       = set_events_for_haplotypes(haplotypes, ref, padded_region);
 
@@ -420,7 +420,8 @@ class Genotyper {
       SPDLOG_DEBUG("{}", ss.str());
 
       const auto allele_count = alleles.size();
-      if (allele_count > MAX_ALLELE_COUNT)
+      // <NON_REF> takes one of the MAX_ALLELE_COUNT alleles.
+      if (allele_count + non_ref > MAX_ALLELE_COUNT)
         continue;
       const auto allele_mapper = get_allele_mapper(alleles, begin, haplotypes);
       const auto haplotype_mapper
@@ -499,6 +500,8 @@ class Genotyper {
                           .pls = new_pls,
                           .gq = RangeUtils::second<std::ranges::less>(new_pls),
                           .qual = phred_scaled_confidence});
+      if (non_ref)
+        add_non_ref(variants.back(), alleles, allele_likelihoods);
       SPDLOG_DEBUG("{}", variants.back().to_string());
     }
     return variants;
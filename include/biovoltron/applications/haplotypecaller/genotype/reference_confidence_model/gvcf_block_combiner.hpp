@@ -0,0 +1,153 @@
+#pragma once
+
+#include <biovoltron/applications/haplotypecaller/genotype/reference_confidence_model/reference_confidence_model.hpp>
+#include <biovoltron/file_io/vcf.hpp>
+#include <biovoltron/utility/interval.hpp>
+#include <algorithm>
+#include <optional>
+
+namespace biovoltron {
+
+/**
+ * @ingroup applications
+ * @brief Merges per-base reference confidences into GVCF blocks.
+ *
+ * Consecutive bases whose GQ falls in the same band share one <NON_REF>
+ * record. The record's END is the last base of the block, GQ and MIN_DP
+ * are the lowest of its bases, and each PL is the lowest of its bases.
+ * A block is passed to the output as soon as a base no longer extends
+ * it, so only the open block is held in memory.
+ */
+class GvcfBlockCombiner {
+ public:
+  /**
+   * @param gq_bands Ascending band edges, band i holding the GQs in
+   * [gq_bands[i - 1], gq_bands[i]).
+   */
+  explicit GvcfBlockCombiner(std::vector<int> gq_bands)
+    : gq_bands(std::move(gq_bands)) {}
+
+  /**
+   * @return The VCF header lines declaring the <NON_REF> allele, the
+   * fields of the blocks and their GQ bands.
+   */
+  auto
+  header_lines() const {
+    auto lines = std::vector<std::string>{
+      "##ALT=<ID=NON_REF,Description=\"Represents any possible alternative "
+      "allele not already represented at this location by REF and ALT\">",
+      "##INFO=<ID=END,Number=1,Type=Integer,"
+      "Description=\"Stop position of the interval\">",
+      "##FORMAT=<ID=MIN_DP,Number=1,Type=Integer,"
+      "Description=\"Minimum DP observed within the GVCF block\">"};
+    const auto add_band = [&](int min_gq, int max_gq) {
+      lines.push_back("##GVCFBlock" + std::to_string(min_gq) + "-"
+                      + std::to_string(max_gq) + "=minGQ="
+                      + std::to_string(min_gq) + "(inclusive),maxGQ="
+                      + std::to_string(max_gq) + "(exclusive)");
+    };
+    auto min_gq = 0;
+    for (auto max_gq : gq_bands) {
+      add_band(min_gq, max_gq);
+      min_gq = max_gq;
+    }
+    add_band(min_gq, ReferenceConfidenceModel::MAX_GQ + 1);
+    return lines;
+  }
+
+  /**
+   * Add the reference confidence of the base at pos, 0-based. Bases
+   * covered by a variant passed to cover are ignored.
+   */
+  template <std::invocable<VcfRecord> Output>
+  auto
+  add(std::string_view chrom, std::uint32_t pos, char ref_base,
+      const ReferenceConfidenceModel::RefConfidence& confidence,
+      Output&& output) {
+    if (chrom == covered.chrom && pos < covered.end)
+      return;
+    const auto band = std::ranges::upper_bound(gq_bands, confidence.gq)
+                      - gq_bands.begin();
+    if (block && (block->band != band || block->end != pos
+                  || block->chrom != chrom))
+      flush(output);
+
+    if (!block) {
+      block = Block{.chrom = std::string{chrom},
+                    .begin = pos,
+                    .end = pos,
+                    .ref_base = ref_base,
+                    .band = band,
+                    .min_gq = confidence.gq,
+                    .min_depth = confidence.depth,
+                    .min_pls = confidence.pls};
+    } else {
+      block->min_gq = std::min(block->min_gq, confidence.gq);
+      block->min_depth = std::min(block->min_depth, confidence.depth);
+      for (auto i = 0; i < 3; i++)
+        block->min_pls[i] = std::min(block->min_pls[i], confidence.pls[i]);
+    }
+    block->end = pos + 1;
+  }
+
+  /**
+   * Close the open block before a variant, whose bases get no block.
+   */
+  template <std::invocable<VcfRecord> Output>
+  auto
+  cover(const Interval& variant_location, Output&& output) {
+    flush(output);
+    if (variant_location.chrom != covered.chrom)
+      covered = variant_location;
+    else
+      covered.end = std::max(covered.end, variant_location.end);
+  }
+
+  /**
+   * Pass the open block, if any, to output.
+   */
+  template <std::invocable<VcfRecord> Output>
+  auto
+  flush(Output&& output) {
+    if (block)
+      output(to_record(*block));
+    block.reset();
+  }
+
+ private:
+  struct Block {
+    std::string chrom;
+    std::uint32_t begin;
+    std::uint32_t end;
+    char ref_base;
+    std::ptrdiff_t band;
+    int min_gq;
+    std::uint32_t min_depth;
+    std::array<int, 3> min_pls;
+  };
+
+  static auto
+  to_record(const Block& block) {
+    auto record = VcfRecord{};
+    record.chrom = block.chrom;
+    record.pos = block.begin + 1;
+    record.id = ".";
+    record.ref = block.ref_base;
+    record.alt = "<NON_REF>";
+    record.filter = ".";
+    record.info = "END=" + std::to_string(block.end);
+    record.format = "GT:GQ:MIN_DP:PL";
+    record.samples = {"0/0:" + std::to_string(block.min_gq) + ":"
+                      + std::to_string(block.min_depth) + ":"
+                      + std::to_string(block.min_pls[0]) + ","
+                      + std::to_string(block.min_pls[1]) + ","
+                      + std::to_string(block.min_pls[2])};
+    return record;
+  }
+
+  std::vector<int> gq_bands;
+  std::optional<Block> block;
+  Interval covered;
+};
+
+}  // namespace biovoltron
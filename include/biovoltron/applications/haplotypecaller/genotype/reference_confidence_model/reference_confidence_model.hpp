@@ -3,6 +3,7 @@
 #include <biovoltron/math/math_utils.hpp>
 #include <biovoltron/utility/istring.hpp>
 #include <biovoltron/utility/read/quality_utils.hpp>
+#include <array>
 
 namespace biovoltron {
 
@@ -11,6 +12,17 @@ struct ReferenceConfidenceModel {
   constexpr static auto LOG10_ONE_THIRD = -0.47712125472;
   constexpr static auto REF_MODEL_DELETION_QUAL = 30;
   constexpr static auto LOG10_PLOIDY = 0.30103;  // log10(2)
+  constexpr static auto MAX_GQ = 99;
+
+  /**
+   * Phred-scaled likelihoods of the hom-ref, het and hom-var genotypes
+   * against any non-reference allele, and the confidence in hom-ref.
+   */
+  struct RefConfidence {
+    std::array<int, 3> pls{};
+    int gq{};
+    std::uint32_t depth{};
+  };
 
   static auto
   apply_pileup_element_ref_vs_non_ref_likelihood_and_count(
@@ -34,6 +46,25 @@ struct ReferenceConfidenceModel {
     return genotype_likelihoods;
   }
 
+  /**
+   * Confidence in hom-ref of a site from genotype likelihoods accumulated
+   * by apply_pileup_element_ref_vs_non_ref_likelihood_and_count. GQ is 0
+   * where hom-ref is not the most likely genotype.
+   *
+   * @param depth Number of pileup elements behind the likelihoods.
+   */
+  static auto
+  calc_ref_confidence(const std::array<double, 3>& genotype_likelihoods,
+                      std::uint32_t depth) {
+    auto confidence = RefConfidence{.depth = depth};
+    const auto max = std::ranges::max(genotype_likelihoods);
+    for (auto i = 0; i < 3; i++)
+      confidence.pls[i] = std::round(-10 * (genotype_likelihoods[i] - max));
+    if (confidence.pls[0] == 0)
+      confidence.gq = std::min({confidence.pls[1], confidence.pls[2], MAX_GQ});
+    return confidence;
+  }
+
  private:
   static auto
   calc_genotype_likelihoods_of_ref_vs_any(const std::vector<ichar>& read_pileup,
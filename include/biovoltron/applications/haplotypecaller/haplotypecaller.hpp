@@ -1,15 +1,24 @@
 #pragma once
 
-#include <biovoltron/algo/align/inexact_match/pairhmm.hpp>
+#include <biovoltron/algo/align/inexact_match/pairhmm_job_queue.hpp>
 #include <biovoltron/algo/assemble/assembler.hpp>
+#include <biovoltron/applications/haplotypecaller/activity_profile.hpp>
 #include <biovoltron/applications/haplotypecaller/genotype/genotyper.hpp>
+#include <biovoltron/applications/haplotypecaller/genotype/reference_confidence_model/gvcf_block_combiner.hpp>
+#include <biovoltron/file_io/bam.hpp>
 #include <biovoltron/file_io/fasta.hpp>
 #include <biovoltron/file_io/vcf.hpp>
 #include <biovoltron/utility/read/read_clipper.hpp>
 #include <biovoltron/utility/read/read_filter.hpp>
-#include <random>
+#include <biovoltron/utility/threadpool/parallel_for.hpp>
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <span>
 #include <spdlog/spdlog.h>
 #include <sstream>
+#include <stdexcept>
+#include <thread>
 
 namespace biovoltron {
 
@@ -20,8 +29,26 @@ namespace biovoltron {
 struct HaplotypeCaller {
   struct Parameters {
     const int MAX_READS_PER_ALIGN_BEGIN = 5;
+    // Seeds the choice of reads kept at alignment begins with more than
+    // MAX_READS_PER_ALIGN_BEGIN, so runs with one seed call alike.
+    const std::uint64_t DOWNSAMPLE_SEED = 0;
     const std::uint32_t REGION_SIZE = 100;
     const std::uint32_t PADDING_SIZE = 100;
+    const std::uint32_t STREAM_BATCH_WINDOWS = 64;
+    // Windows whose activity stays below this are not assembled;
+    // 0 assembles every window with reads.
+    const double ACTIVE_PROB_THRESHOLD = 0.002;
+    // Emit GVCF: reference confidence blocks between the variants, from
+    // the first base of the reference on, and <NON_REF> on the variants.
+    // Consecutive bases share a block while their GQ stays within one of
+    // the bands split at these edges. See vcf_header for the header.
+    const bool GVCF = false;
+    const std::vector<int> GVCF_GQ_BANDS = {5, 20, 60};
+  };
+  // Window counts of one run, filled by run when asked for.
+  struct RunStats {
+    std::uint32_t window_cnt{};
+    std::size_t skipped_cnt{};
   };
   // need transform to upper case
   const FastaRecord<> ref;
@@ -31,63 +58,142 @@ struct HaplotypeCaller {
   const Parameters args;
 
  private:
-  // TODO: this need huge improve
-  auto
-  generate_reads_map(const std::vector<SamRecord<>>& sam) const {
-    std::vector<std::vector<SamRecord<>>> reads_map;
-    reads_map.resize(ref.seq.size());
+  using ReadsIndex = std::vector<const SamRecord<>*>;
+
+  constexpr static auto read_begin = [](const SamRecord<>* record) {
+    return record->begin();
+  };
+
+  // Reads with non-zero mapq sorted by alignment begin, so the reads
+  // starting in a window are a contiguous slice.
+  static auto
+  generate_reads_index(const auto& sam) {
+    auto reads_index = ReadsIndex{};
     for (const auto& record : sam)
       if (record.mapq != 0)
-        reads_map[record.begin()].emplace_back(record);
-    return reads_map;
+        reads_index.push_back(&record);
+    std::ranges::stable_sort(reads_index, {}, read_begin);
+    return reads_index;
+  }
+
+  // Append at most MAX_READS_PER_ALIGN_BEGIN of the reads sharing one
+  // alignment begin, in their order. Each read is kept with probability
+  // needed / left (selection sampling), drawn from a splitmix64 stream
+  // seeded by DOWNSAMPLE_SEED and the begin. Every window, thread and run
+  // then keeps the same reads of a begin.
+  auto
+  sample_reads(std::span<const SamRecord<>* const> reads,
+               ReadsIndex& sampled_reads) const {
+    if (reads.size() <= args.MAX_READS_PER_ALIGN_BEGIN) {
+      sampled_reads.insert(sampled_reads.end(), reads.begin(), reads.end());
+      return;
+    }
+    auto state = args.DOWNSAMPLE_SEED
+                 ^ read_begin(reads.front()) * 0x9e3779b97f4a7c15;
+    const auto next = [&state] {
+      auto z = state += 0x9e3779b97f4a7c15;
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+      return z ^ (z >> 31);
+    };
+    auto needed = static_cast<std::uint64_t>(args.MAX_READS_PER_ALIGN_BEGIN);
+    for (auto i = std::size_t{}; needed != 0; i++) {
+      const auto left = static_cast<std::uint64_t>(reads.size() - i);
+      if ((next() >> 32) * left >> 32 < needed) {
+        sampled_reads.push_back(reads[i]);
+        needed--;
+      }
+    }
   }
 
+  // Reads starting in region, sampled per alignment begin. The reads stay
+  // in reads_index's records until hard_clip_reads copies the survivors.
   auto
-  sample_reads(const std::vector<SamRecord<>>& reads) const {
-    if (reads.size() <= args.MAX_READS_PER_ALIGN_BEGIN)
-      return reads;
-    auto sampled_reads = std::vector<SamRecord<>>{};
-    std::ranges::sample(reads, std::back_inserter(sampled_reads),
-                        args.MAX_READS_PER_ALIGN_BEGIN,
-                        std::mt19937{std::random_device{}()});
-    return sampled_reads;
+  gather_reads(const ReadsIndex& reads_index, const Interval& region) const {
+    auto reads = ReadsIndex{};
+    auto first = std::ranges::lower_bound(reads_index, region.begin, {}, read_begin);
+    const auto last = std::ranges::lower_bound(
+      first, reads_index.end(), region.end, {}, read_begin);
+    while (first != last) {
+      const auto next = std::ranges::upper_bound(
+        first, last, read_begin(*first), {}, read_begin);
+      sample_reads({first, next}, reads);
+      first = next;
+    }
+    return reads;
   }
 
+  constexpr static auto read_filter = CompositeReadFilter{
+    MappingQualityReadFilter{}, DuplicateReadFilter{},
+    SecondaryAlignmentReadFilter{}, MateOnSameContigReadFilter{}};
+
   static auto
-  filter_reads(std::vector<SamRecord<>>& reads) {
-    std::erase_if(reads, MappingQualityReadFilter{});
-    std::erase_if(reads, DuplicateReadFilter{});
-    std::erase_if(reads, SecondaryAlignmentReadFilter{});
-    std::erase_if(reads, MateOnSameContigReadFilter{});
+  filter_reads(ReadsIndex& reads) {
+    std::erase_if(reads, [](const auto* read) { return read_filter(*read); });
   }
 
+  // Copies of the reads reverted and clipped to padded_region, minus the
+  // ones left too short. The clips are taken as offsets first, so each
+  // kept read's strings are copied once, already clipped.
   static auto
-  hard_clip_reads(std::vector<SamRecord<>>& reads,
-                  const Interval& padded_region) {
-    for (auto& read : reads) ReadClipper::revert_soft_clipped_bases(read);
-    for (auto& read : reads)
+  hard_clip_reads(const ReadsIndex& reads, const Interval& padded_region) {
+    auto clipped_reads = std::vector<SamRecord<>>{};
+    clipped_reads.reserve(reads.size());
+    for (const auto* record : reads) {
+      auto read = ClippedRead<>{record};
+      ReadClipper::revert_soft_clipped_bases(read);
       ReadClipper::hard_clip_to_interval(read, padded_region);
-    std::erase_if(reads, MinimumLengthReadFilter{});
+      if (!MinimumLengthReadFilter{}(read))
+        clipped_reads.push_back(read.materialize());
+    }
+    return clipped_reads;
   }
 
+  // A window between assembly and genotyping. The windows of a batch
+  // are kept for the next one, whose assembly overwrites the haplotypes
+  // in place.
+  struct Window {
+    std::vector<SamRecord<>> reads;
+    std::vector<Haplotype> haplotypes;
+    std::size_t job;
+  };
+
+  // Buffers of one pool worker, kept for the whole run.
+  struct WorkerBuffers {
+    HaplotypeAssembler::Workspace assembler;
+    PairHMM::Workspace pairhmm;
+  };
+
+  // The calls of a window, and in GVCF mode the reference confidence of
+  // each base of its confidence region, left empty without reads.
+  struct WindowCalls {
+    std::vector<Variant> variants;
+    std::vector<ReferenceConfidenceModel::RefConfidence> ref_confidences;
+  };
+
   auto
-  call_region(std::vector<SamRecord<>>& reads, std::string_view ref,
-              const Interval& padded_region,
-              const Interval& origin_region) const -> std::vector<Variant> {
-    filter_reads(reads);
-    hard_clip_reads(reads, padded_region);
-
-    if (reads.empty())
-      return {};
+  assemble_region(const std::vector<SamRecord<>>& reads, std::string_view ref,
+                  const Interval& padded_region,
+                  const Interval& origin_region, std::size_t threads,
+                  HaplotypeAssembler::Workspace& workspace,
+                  std::vector<Haplotype>& haplotypes) const -> void {
+    if (reads.empty()) {
+      haplotypes.clear();
+      return;
+    }
     SPDLOG_DEBUG("----------------------------------------------------------------------------------");
     SPDLOG_DEBUG("Assembling {} with {} reads:   (with overlap region = {})", origin_region.to_string(),
       reads.size(), padded_region.to_string());
 
-    auto haplotypes = assembler.assemble(reads, ref);
-    if (haplotypes.size() <= 1)
-      return {};
+    assembler.assemble(reads, ref, workspace, haplotypes, threads);
+  }
 
-    auto likelihoods = pairhmm.compute_likelihoods(haplotypes, reads);
+  auto
+  genotype_region(const std::vector<SamRecord<>>& reads,
+                  std::vector<Haplotype>& haplotypes,
+                  const std::vector<std::vector<double>>& likelihoods,
+                  std::string_view ref, const Interval& padded_region,
+                  const Interval& origin_region) const -> std::vector<Variant> {
     SPDLOG_DEBUG("----------------------------------------------------------------------------------");
     SPDLOG_DEBUG("Pairhmm values:");
     std::stringstream ss;
@@ -102,56 +208,307 @@ struct HaplotypeCaller {
     SPDLOG_DEBUG("----------------------------------------------------------------------------------");
     SPDLOG_DEBUG("Genotyping:");
     return genotyper.assign_genotype_likelihoods(
-      reads, haplotypes, likelihoods, ref, padded_region, origin_region);
+      reads, haplotypes, likelihoods, ref, padded_region, origin_region,
+      args.GVCF);
   }
 
- public:
   auto
-  run(const std::vector<SamRecord<>>& sam) const {
-    const auto ref = static_cast<std::string_view>(this->ref.seq);
-    auto raw_variants = std::vector<VcfRecord>{};
-
+  window_cnt() const -> std::uint32_t {
     // const auto start_begin = 16050000;
     const auto start_begin = args.PADDING_SIZE;
+    if (ref.seq.size() <= start_begin)
+      return 0;
+    return (ref.seq.size() - start_begin + args.REGION_SIZE - 1) / args.REGION_SIZE;
+  }
+
+  auto
+  origin_region_of(std::uint32_t window) const {
+    const auto begin = args.PADDING_SIZE + window * args.REGION_SIZE;
+    return Interval{ref.name, begin, begin + args.REGION_SIZE};
+  }
 
-    auto window_cnt
-      = (ref.size() - start_begin + args.REGION_SIZE - 1) / args.REGION_SIZE;
-    auto origin_region
-      = Interval{this->ref.name, start_begin, start_begin + args.REGION_SIZE};
-    auto padded_region = origin_region;
+  auto
+  padded_region_of(std::uint32_t window) const {
+    auto padded_region = origin_region_of(window);
     padded_region.begin -= args.PADDING_SIZE;
     padded_region.end += args.PADDING_SIZE;
+    return padded_region;
+  }
+
+  // Bases whose reference confidence a window reports: its origin region,
+  // within the reference, and for the first window the bases before it.
+  auto
+  confidence_region_of(std::uint32_t window) const {
+    auto region = origin_region_of(window);
+    if (window == 0)
+      region.begin = 0;
+    region.end = std::min<std::uint32_t>(region.end, ref.seq.size());
+    return region;
+  }
+
+  // Pass the calls of the windows from first on to output in coordinate
+  // order. In GVCF mode the reference confidence of the bases between
+  // the variants goes through blocks.
+  template <typename Output>
+  auto
+  emit_calls(std::uint32_t first, const std::vector<WindowCalls>& calls,
+             GvcfBlockCombiner& blocks, Output&& output) const {
+    auto record_cnt = std::size_t{};
+    const auto emit = [&](VcfRecord record) {
+      output(std::move(record));
+      record_cnt++;
+    };
+    for (auto i = 0u; i < calls.size(); i++) {
+      const auto& [variants, ref_confidences] = calls[i];
+      if (!args.GVCF) {
+        for (const auto& variant : variants)
+          emit(static_cast<VcfRecord>(variant));
+        continue;
+      }
 
-    auto reads_map = generate_reads_map(sam);
-    for (auto i = 0; i < window_cnt; i++) {
-      auto reads = std::vector<SamRecord<>>{};
-      for (auto begin = padded_region.begin; begin != padded_region.end;
-           begin++)
-        if (!reads_map[begin].empty() && begin < reads_map.size()) {
-          const auto sampled_reads = sample_reads(reads_map[begin]);
-          reads.insert(reads.end(), sampled_reads.begin(), sampled_reads.end());
+      const auto region = confidence_region_of(first + i);
+      auto variant = variants.begin();
+      for (auto pos = region.begin; pos < region.end; pos++) {
+        for (; variant != variants.end() && variant->location.begin == pos;
+             ++variant) {
+          blocks.cover(variant->location, emit);
+          emit(static_cast<VcfRecord>(*variant));
         }
+        blocks.add(ref.name, pos, ref.seq[pos],
+                   ref_confidences.empty() ?
+                     ReferenceConfidenceModel::RefConfidence{} :
+                     ref_confidences[pos - region.begin],
+                   emit);
+      }
+    }
+    return record_cnt;
+  }
+
+  // Call windows [first, last) on the workers of `pool`. Each window samples
+  // and filters pointers to its reads, and only an active window copies
+  // them, clipped, to assemble its haplotypes, trying several kmer sizes
+  // at once when there are fewer windows than workers. The PairHMM
+  // jobs of all windows then run as one batch before each window is
+  // genotyped. Windows without activity are skipped and counted in
+  // skipped_cnt. In GVCF mode every window with reads also piles them up
+  // for its reference confidence. The windows buffer and the buffers of
+  // each worker are carried from batch to batch.
+  auto
+  call_windows(const ReadsIndex& reads_index, std::uint32_t first,
+               std::uint32_t last, ParallelForPool& pool,
+               std::vector<WorkerBuffers>& worker_buffers,
+               std::vector<Window>& windows, std::size_t& skipped_cnt) const {
+    const auto ref = static_cast<std::string_view>(this->ref.seq);
+    const auto padded_ref_of = [&](const Interval& padded_region) {
+      return ref.substr(padded_region.begin, padded_region.size());
+    };
+    windows.resize(last - first);
+    auto calls = std::vector<WindowCalls>(last - first);
+    const auto assemble_threads
+      = std::max<std::size_t>(1, pool.size() / std::max(last - first, 1u));
+    auto skipped = std::atomic<std::size_t>{};
+    pool.run(last - first, 1, [&](auto i, auto worker) {
+      const auto origin_region = origin_region_of(first + i);
+      const auto padded_region = padded_region_of(first + i);
 
+      auto reads = gather_reads(reads_index, padded_region);
       if (reads.empty()) {
         SPDLOG_DEBUG("Ignore {}:    (with overlap region = {})", origin_region.to_string(), padded_region.to_string());
-      } else {
-        const auto region_variants = call_region(
-          reads, ref.substr(padded_region.begin, padded_region.size()),
-          padded_region, origin_region);
-        for (const auto& region_variant : region_variants)
-          SPDLOG_DEBUG(region_variant.to_string());
-        raw_variants.insert(raw_variants.end(), region_variants.begin(),
-                            region_variants.end());
+        windows[i].haplotypes.clear();
+        return;
+      }
+      const auto padded_ref = padded_ref_of(padded_region);
+      filter_reads(reads);
+      if (args.GVCF) {
+        const auto confidence_region = confidence_region_of(first + i);
+        for (const auto& [likelihoods, depth] : ActivityProfile::pileup(
+               reads, padded_ref, padded_region, confidence_region))
+          calls[i].ref_confidences.push_back(
+            ReferenceConfidenceModel::calc_ref_confidence(likelihoods, depth));
       }
+      if (!ActivityProfile::is_active(reads, padded_ref, padded_region,
+                                      origin_region, args.ACTIVE_PROB_THRESHOLD)) {
+        SPDLOG_DEBUG("Skip inactive {}", origin_region.to_string());
+        skipped++;
+        windows[i].haplotypes.clear();
+        return;
+      }
+      windows[i].reads = hard_clip_reads(reads, padded_region);
+      assemble_region(windows[i].reads, padded_ref, padded_region,
+                      origin_region, assemble_threads,
+                      worker_buffers[worker].assembler, windows[i].haplotypes);
+    });
+    skipped_cnt += skipped;
+
+    auto jobs = PairHMMJobQueue{pairhmm};
+    for (auto& window : windows)
+      if (window.haplotypes.size() > 1)
+        window.job = jobs.push(window.haplotypes, window.reads);
+    pool.run(jobs.schedule(), 1, [&](auto task, auto worker) {
+      jobs.run(task, worker_buffers[worker].pairhmm);
+    });
 
-      origin_region.begin += args.REGION_SIZE;
-      origin_region.end += args.REGION_SIZE;
-      padded_region.begin = origin_region.begin - args.PADDING_SIZE;
-      padded_region.end = origin_region.end + args.PADDING_SIZE;
+    pool.run(last - first, 1, [&](auto i) {
+      auto& [reads, haplotypes, job] = windows[i];
+      if (haplotypes.size() <= 1)
+        return;
+      const auto origin_region = origin_region_of(first + i);
+      const auto padded_region = padded_region_of(first + i);
+      const auto likelihoods = jobs.take(job, reads);
+      calls[i].variants = genotype_region(reads, haplotypes, likelihoods,
+                                          padded_ref_of(padded_region),
+                                          padded_region, origin_region);
+      for (const auto& region_variant : calls[i].variants)
+        SPDLOG_DEBUG(region_variant.to_string());
+    });
+    return calls;
+  }
+
+ public:
+  /**
+   * @param sample Name of the sample column.
+   * @return The VCF header of the records run emits, declaring the
+   * <NON_REF> allele and the block fields in GVCF mode.
+   */
+  auto
+  vcf_header(std::string_view sample = "SAMPLE") const {
+    auto header = VcfHeader{};
+    header.lines.push_back("##fileformat=VCFv4.2");
+    if (args.GVCF)
+      std::ranges::copy(GvcfBlockCombiner{args.GVCF_GQ_BANDS}.header_lines(),
+                        std::back_inserter(header.lines));
+    header.lines.push_back(
+      "##FORMAT=<ID=GT,Number=1,Type=String,Description=\"Genotype\">");
+    header.lines.push_back("##FORMAT=<ID=GQ,Number=1,Type=Integer,"
+                           "Description=\"Genotype Quality\">");
+    header.lines.push_back(
+      "##FORMAT=<ID=PL,Number=G,Type=Integer,Description=\"Normalized, "
+      "Phred-scaled likelihoods for genotypes as defined in the VCF "
+      "specification\">");
+    header.lines.push_back("##contig=<ID=" + ref.name + ",length="
+                           + std::to_string(ref.seq.size()) + ">");
+    header.lines.push_back(
+      "#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO\tFORMAT\t"
+      + std::string{sample});
+    return header;
+  }
+
+  /**
+   * Call variants window by window on `threads` workers.
+   *
+   * Windows are called independently, a batch of STREAM_BATCH_WINDOWS
+   * at a time, and their variants are merged back in window order.
+   *
+   * @param sam Alignments on the reference chromosome.
+   * @param threads Number of worker threads.
+   * @param stats If not null, receives the window counts of the run.
+   * @return Variants in coordinate order, with the GVCF blocks between
+   * them in GVCF mode.
+   */
+  auto
+  run(const std::vector<SamRecord<>>& sam,
+      std::size_t threads = std::thread::hardware_concurrency(),
+      RunStats* stats = nullptr) const {
+    const auto reads_index = generate_reads_index(sam);
+    auto skipped_cnt = std::size_t{};
+
+    auto raw_variants = std::vector<VcfRecord>{};
+    const auto output = [&](VcfRecord record) {
+      raw_variants.push_back(std::move(record));
+    };
+    auto blocks = GvcfBlockCombiner{args.GVCF_GQ_BANDS};
+    auto batch = std::vector<Window>{};
+    auto pool = ParallelForPool{threads};
+    auto worker_buffers = std::vector<WorkerBuffers>(pool.size());
+
+    const auto windows = window_cnt();
+    for (auto first = 0u; first < windows; first += args.STREAM_BATCH_WINDOWS) {
+      const auto last = std::min(first + args.STREAM_BATCH_WINDOWS, windows);
+      emit_calls(
+        first,
+        call_windows(reads_index, first, last, pool, worker_buffers, batch,
+                     skipped_cnt),
+        blocks, output);
     }
+    blocks.flush(output);
+    if (stats)
+      *stats = {windows, skipped_cnt};
+    SPDLOG_DEBUG("Skipped {} of {} windows without activity", skipped_cnt, windows);
     SPDLOG_DEBUG("HaplotypeCaller done.");
     return raw_variants;
   }
+
+  /**
+   * Call variants from an indexed BAM file, streaming the reads.
+   *
+   * The reads of the reference chromosome are pulled with set_region and
+   * buffered until a batch of STREAM_BATCH_WINDOWS windows is covered.
+   * The batch is called on `threads` workers, its variants are passed to
+   * `output` in coordinate order, and the reads no later window needs
+   * are released. Memory is bounded by the coverage of one batch rather
+   * than by the total number of reads. In GVCF mode the blocks are
+   * passed to output as they close, batch by batch.
+   *
+   * @param bam Coordinate-sorted BAM file with an index.
+   * @param output Called with each VcfRecord in coordinate order.
+   * @param threads Number of worker threads.
+   * @param stats If not null, receives the window counts of the run.
+   * @throw std::runtime_error if the BAM file has no index or lacks the
+   * reference chromosome.
+   * @return Number of records passed to output.
+   */
+  template <std::invocable<VcfRecord> Output>
+  auto
+  run(IBamStream& bam, Output&& output,
+      std::size_t threads = std::thread::hardware_concurrency(),
+      RunStats* stats = nullptr) const {
+    if (!bam.set_region(ref.name, 0, ref.seq.size()))
+      throw std::runtime_error{
+        "Cannot query " + ref.name + " from the BAM file, is it indexed?"};
+
+    auto buffer = std::deque<SamRecord<>>{};
+    auto pending = SamRecord<>{};
+    auto has_pending = static_cast<bool>(bam >> pending);
+    auto record_cnt = std::size_t{};
+    auto skipped_cnt = std::size_t{};
+    auto blocks = GvcfBlockCombiner{args.GVCF_GQ_BANDS};
+    auto batch = std::vector<Window>{};
+    auto pool = ParallelForPool{threads};
+    auto worker_buffers = std::vector<WorkerBuffers>(pool.size());
+
+    const auto windows = window_cnt();
+    for (auto first = 0u; first < windows; first += args.STREAM_BATCH_WINDOWS) {
+      const auto last = std::min(first + args.STREAM_BATCH_WINDOWS, windows);
+
+      // Reads arrive sorted by begin, so the batch is complete once a
+      // read begins past its last padded region.
+      const auto batch_end = padded_region_of(last - 1).end;
+      while (has_pending && pending.begin() < batch_end) {
+        if (pending.mapq != 0)
+          buffer.push_back(std::move(pending));
+        has_pending = static_cast<bool>(bam >> pending);
+      }
+
+      record_cnt += emit_calls(
+        first,
+        call_windows(generate_reads_index(buffer), first, last, pool,
+                     worker_buffers, batch, skipped_cnt),
+        blocks, output);
+
+      const auto next_begin = padded_region_of(last).begin;
+      while (!buffer.empty() && buffer.front().begin() < next_begin)
+        buffer.pop_front();
+    }
+    blocks.flush([&](VcfRecord record) {
+      output(std::move(record));
+      record_cnt++;
+    });
+    if (stats)
+      *stats = {windows, skipped_cnt};
+    SPDLOG_DEBUG("Skipped {} of {} windows without activity", skipped_cnt, windows);
+    SPDLOG_DEBUG("HaplotypeCaller done.");
+    return record_cnt;
+  }
 };
 
 }  // namespace biovoltron
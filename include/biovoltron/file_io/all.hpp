@@ -15,3 +15,4 @@
 #include <biovoltron/file_io/vcf.hpp>
 #include <biovoltron/file_io/wig.hpp>
 #include <biovoltron/file_io/bam.hpp>
+#include <biovoltron/file_io/bam_record.hpp>
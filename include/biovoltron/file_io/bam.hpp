@@ -9,6 +9,7 @@
 #include <fstream>
 
 #include <biovoltron/file_io/sam.hpp>
+#include <biovoltron/file_io/bam_record.hpp>
 
 #include <htslib/sam.h>
 #include <spdlog/spdlog.h>
@@ -412,7 +413,7 @@ struct OBamStream : protected std::ofstream {
       quals,
       65535 // TODO: how to dynamicly adjust size with efficiency
     );*/
-    auto aln = bam_init1();
+    auto aln = os.get_aln();
     os.bam_set1(aln, r, tid, cigars, quals, mtid);
     if (auto c = sam_write1(os.bam, os.bam_header, aln); c < 0) { /* TODO: error handler */
       SPDLOG_ERROR("An error occured when writing to a BAM file");
@@ -420,6 +421,50 @@ struct OBamStream : protected std::ofstream {
     return os;
   }
 
+  /**
+   * @brief inserts a packed BamRecord to the object
+   *
+   * The record's `tid`/`mtid` index the targets of the header written
+   * before. Its variable-length data is copied verbatim into a `bam1_t`
+   * reused across calls, skipping the text parsing of the SamRecord path.
+   *
+   * @param os an OBamStream object to be inserted
+   * @param r an input BamRecord object
+   * @throw std::runtime_error if the record cannot be written
+   */
+  friend auto& operator<<(OBamStream& os, const BamRecord& r) {
+    auto aln = os.get_aln();
+    if (aln->m_data < r.data.size()) {
+      auto new_data = reinterpret_cast<std::uint8_t*>(
+        std::realloc(aln->data, r.data.size()));
+      if (new_data == nullptr)
+        throw std::bad_alloc{};
+      aln->data = new_data;
+      aln->m_data = r.data.size();
+    }
+    if (!r.data.empty())
+      std::memcpy(aln->data, r.data.data(), r.data.size());
+    aln->l_data = r.data.size();
+    aln->core.tid = r.tid;
+    aln->core.pos = r.pos;
+    aln->core.qual = r.mapq;
+    aln->core.l_extranul = r.l_extranul;
+    aln->core.flag = r.flag;
+    aln->core.l_qname = r.l_qname;
+    aln->core.n_cigar = r.n_cigar;
+    aln->core.l_qseq = r.l_qseq;
+    aln->core.mtid = r.mtid;
+    aln->core.mpos = r.mpos;
+    aln->core.isize = r.isize;
+    auto rlen = hts_pos_t { 0 };
+    if (!(r.flag & BAM_FUNMAP)) rlen = bam_cigar2rlen(r.n_cigar, bam_get_cigar(aln));
+    if (rlen == 0) rlen = 1;
+    aln->core.bin = hts_reg2bin(r.pos, r.pos + rlen, 14, 5);
+    if (sam_write1(os.bam, os.bam_header, aln) < 0)
+      throw std::runtime_error("An error occured when writing to a BAM file.");
+    return os;
+  }
+
   auto clear() {
     if (write_idx) {
       if (auto c = sam_idx_save(bam); c != 0) {
@@ -432,8 +477,12 @@ struct OBamStream : protected std::ofstream {
     if (bam) {
       sam_close(bam);
     }
+    if (aln) {
+      bam_destroy1(aln);
+    }
     bam = nullptr;
     bam_header = nullptr;
+    aln = nullptr;
     ref_table.clear();
     path.clear();
   }
@@ -482,12 +531,14 @@ struct OBamStream : protected std::ofstream {
   OBamStream(OBamStream&& other) noexcept {
     bam = other.bam;
     bam_header = other.bam_header;
+    aln = other.aln;
     ref_table = std::move(other.ref_table);
     path = std::move(other.path);
     idx_path = std::move(other.idx_path);
     write_idx = other.write_idx;
     other.bam = nullptr;
     other.bam_header = nullptr;
+    other.aln = nullptr;
     other.write_idx = false;
   }
 
@@ -499,6 +550,15 @@ struct OBamStream : protected std::ofstream {
   }
 
 private:
+  /**
+   * @brief the record buffer reused by every insertion
+   */
+  auto get_aln() -> bam1_t* {
+    if (aln == nullptr)
+      aln = bam_init1();
+    return aln;
+  }
+
   template <typename T, typename U>
   auto convert_type_and_copy(U source, std::uint8_t* dest) {
     auto d = static_cast<T>(source);
@@ -702,6 +762,7 @@ private:
  private:
   samFile* bam = nullptr;
   bam_hdr_t* bam_header = nullptr;
+  bam1_t* aln = nullptr;
   std::map<std::string, std::int32_t> ref_table;
   bool write_idx = false;
   std::filesystem::path path;
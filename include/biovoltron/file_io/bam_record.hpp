@@ -0,0 +1,275 @@
+#pragma once
+
+#include <biovoltron/file_io/cigar.hpp>
+#include <biovoltron/utility/istring.hpp>
+#include <array>
+#include <concepts>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <ranges>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace biovoltron {
+
+/**
+ * @ingroup file_io
+ * @brief A packed BAM alignment record which does not depend on htslib.
+ *
+ * The fixed fields mirror htslib's `bam1_core_t` (`bin` is computed when
+ * the record is written), and `data` holds the variable-length part in
+ * the `bam1_t::data` layout: the NUL-padded read name, the packed CIGAR,
+ * the 4-bit encoded sequence, the qualities and the binary aux fields.
+ *
+ * Producers append the variable-length fields in that order (qname,
+ * cigar, seq, qual, aux). `clear()` keeps the buffer capacity, so a
+ * record reused for every read reaches a steady state without heap
+ * allocation. Write it with `OBamStream << record`.
+ *
+ * Example
+ * ```cpp
+ * #include <biovoltron/file_io/bam_record.hpp>
+ * #include <iostream>
+ *
+ * int main() {
+ *   using namespace biovoltron;
+ *   auto record = BamRecord{};
+ *   record.tid = 0;
+ *   record.pos = 99;
+ *   record.append_qname("read1");
+ *   record.append_cigar("5M");
+ *   record.append_seq(std::string_view{"ACGTN"});
+ *   record.append_qual("IIIII");
+ *   record.append_aux("AS", 5);
+ *   std::cout << record.get_qname() << " " << record.get_seq() << "\n";
+ *   // Output: read1 ACGTN
+ * }
+ * ```
+ */
+struct BamRecord {
+  std::int32_t tid = -1;     ///< Reference id, -1 for unmapped.
+  std::int64_t pos = -1;     ///< 0-based leftmost position.
+  std::uint8_t mapq{};       ///< Mapping quality.
+  std::uint8_t l_extranul{}; ///< Extra NULs padding the read name.
+  std::uint16_t flag{};      ///< Bitwise flag.
+  std::uint16_t l_qname{};   ///< Read name length, NULs included.
+  std::uint32_t n_cigar{};   ///< Number of CIGAR operations.
+  std::int32_t l_qseq{};     ///< Read length.
+  std::int32_t mtid = -1;    ///< Mate reference id.
+  std::int64_t mpos = -1;    ///< Mate 0-based position.
+  std::int64_t isize{};      ///< Template length.
+  std::vector<std::uint8_t> data; ///< Variable-length part, as `bam1_t::data`.
+
+  constexpr static auto CIGAR_OPS = std::string_view{"MIDNSHP=XB"};
+
+  /// 4-bit code of the encoded bases A, C, G, T, N.
+  constexpr static auto NT16 = std::array<std::uint8_t, 5>{1, 2, 4, 8, 15};
+
+  /**
+   * @brief Resets all fields, keeping the capacity of `data`.
+   */
+  auto
+  clear() noexcept {
+    auto buffer = std::move(data);
+    buffer.clear();
+    *this = BamRecord{};
+    data = std::move(buffer);
+  }
+
+  /**
+   * @brief Appends the read name, NUL-padded to a 4-byte boundary.
+   */
+  auto
+  append_qname(std::string_view qname) {
+    const auto nuls = 4 - qname.size() % 4;
+    data.insert(data.end(), qname.begin(), qname.end());
+    data.insert(data.end(), nuls, '\0');
+    l_qname = qname.size() + nuls;
+    l_extranul = nuls - 1;
+  }
+
+  /**
+   * @brief Packs a CIGAR string (e.g. `"5S30M"`) into 32-bit operations.
+   * @details `"*"` and the empty string append no operation.
+   * @return Number of reference bases the CIGAR covers.
+   */
+  auto
+  append_cigar(std::string_view cigar) {
+    auto ref_size = std::uint32_t{};
+    auto size = std::uint32_t{};
+    for (const auto c : cigar) {
+      if (c >= '0' && c <= '9') {
+        size = size * 10 + (c - '0');
+        continue;
+      }
+      const auto op = CIGAR_OPS.find(c);
+      if (op == std::string_view::npos)
+        continue;
+      append_bytes(size << 4 | static_cast<std::uint32_t>(op));
+      n_cigar++;
+      // M, D, N, =, X consume reference.
+      if (c == 'M' || c == 'D' || c == 'N' || c == '=' || c == 'X')
+        ref_size += size;
+      size = 0;
+    }
+    return ref_size;
+  }
+
+  /**
+   * @brief Packs a sequence into 4-bit codes, two bases per byte.
+   * @details Accepts either an encoded `istring_view` (0-4) or an ASCII
+   * `std::string_view`.
+   */
+  template<typename Seq>
+  auto
+  append_seq(const Seq& seq) {
+    const auto to_nt16 = [](auto c) {
+      if constexpr (std::same_as<std::ranges::range_value_t<Seq>, char>)
+        return NT16[Codec::to_int(c)];
+      else
+        return NT16[c < 4 ? c : 4];
+    };
+    auto i = std::size_t{};
+    for (; i + 1 < seq.size(); i += 2)
+      data.push_back(to_nt16(seq[i]) << 4 | to_nt16(seq[i + 1]));
+    if (i < seq.size())
+      data.push_back(to_nt16(seq[i]) << 4);
+    l_qseq = seq.size();
+  }
+
+  /**
+   * @brief Appends phred+33 qualities, optionally in reverse order.
+   * @details `"*"` or a size mismatch with the sequence is stored as
+   * missing qualities (0xff).
+   */
+  auto
+  append_qual(std::string_view qual, bool reverse = false) {
+    if (qual.size() != l_qseq) {
+      data.insert(data.end(), l_qseq, 0xff);
+      return;
+    }
+    if (reverse)
+      for (auto it = qual.rbegin(); it != qual.rend(); ++it)
+        data.push_back(*it - 33);
+    else
+      for (const auto c : qual) data.push_back(c - 33);
+  }
+
+  /**
+   * @brief Appends an integer aux field using the smallest fitting type.
+   */
+  auto
+  append_aux(std::string_view tag, std::int64_t value) {
+    data.push_back(tag[0]);
+    data.push_back(tag[1]);
+    if (value < 0) {
+      if (value >= std::numeric_limits<std::int8_t>::min())
+        append_typed<std::int8_t>('c', value);
+      else if (value >= std::numeric_limits<std::int16_t>::min())
+        append_typed<std::int16_t>('s', value);
+      else
+        append_typed<std::int32_t>('i', value);
+    } else {
+      if (value <= std::numeric_limits<std::uint8_t>::max())
+        append_typed<std::uint8_t>('C', value);
+      else if (value <= std::numeric_limits<std::uint16_t>::max())
+        append_typed<std::uint16_t>('S', value);
+      else
+        append_typed<std::uint32_t>('I', value);
+    }
+  }
+
+  /**
+   * @brief Appends a string (`Z`) aux field.
+   */
+  auto
+  append_aux(std::string_view tag, std::string_view value) {
+    data.push_back(tag[0]);
+    data.push_back(tag[1]);
+    data.push_back('Z');
+    data.insert(data.end(), value.begin(), value.end());
+    data.push_back('\0');
+  }
+
+  /**
+   * @brief Read name without padding.
+   */
+  auto
+  get_qname() const {
+    return std::string_view{reinterpret_cast<const char*>(data.data())};
+  }
+
+  /**
+   * @brief Unpacks the CIGAR operations.
+   */
+  auto
+  get_cigar() const {
+    auto cigar = Cigar{};
+    for (auto i = 0u; i < n_cigar; i++) {
+      auto op = std::uint32_t{};
+      std::memcpy(&op, data.data() + l_qname + i * 4, sizeof(op));
+      cigar.emplace_back(op >> 4, CIGAR_OPS[op & 0xf]);
+    }
+    return cigar;
+  }
+
+  /**
+   * @brief Unpacks the sequence to ASCII.
+   */
+  auto
+  get_seq() const {
+    constexpr auto nt16_str = std::string_view{"=ACMGRSVTWYHKDBN"};
+    const auto packed = data.data() + l_qname + n_cigar * 4;
+    auto seq = std::string{};
+    seq.reserve(l_qseq);
+    for (auto i = 0; i < l_qseq; i++)
+      seq += nt16_str[packed[i / 2] >> ((~i & 1) << 2) & 0xf];
+    return seq;
+  }
+
+  /**
+   * @brief Qualities as phred+33, or `"*"` if missing.
+   */
+  auto
+  get_qual() const {
+    const auto qual
+      = data.data() + l_qname + n_cigar * 4 + (l_qseq + 1) / 2;
+    if (l_qseq == 0 || qual[0] == 0xff)
+      return std::string{"*"};
+    auto res = std::string{};
+    res.reserve(l_qseq);
+    for (auto i = 0; i < l_qseq; i++) res += static_cast<char>(qual[i] + 33);
+    return res;
+  }
+
+  /**
+   * @brief Binary aux fields.
+   */
+  auto
+  get_aux() const {
+    const auto offset
+      = l_qname + n_cigar * 4 + (l_qseq + 1) / 2 + l_qseq;
+    return std::span<const std::uint8_t>{data}.subspan(offset);
+  }
+
+ private:
+  template<typename T>
+  auto
+  append_bytes(T value) -> void {
+    const auto old_size = data.size();
+    data.resize(old_size + sizeof(T));
+    std::memcpy(data.data() + old_size, &value, sizeof(T));
+  }
+
+  template<typename T>
+  auto
+  append_typed(char type, std::int64_t value) -> void {
+    data.push_back(type);
+    append_bytes(static_cast<T>(value));
+  }
+};
+
+}  // namespace biovoltron
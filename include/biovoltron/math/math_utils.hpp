@@ -117,6 +117,24 @@ struct MathUtils {
     return b;
   }
 
+  /**
+   * approximate_log10_sum_log10 of each pair of a and b, into result.
+   * Branch-free, so the loop vectorizes.
+   */
+  static auto
+  approximate_log10_sum_log10(std::span<const double> a,
+                              std::span<const double> b,
+                              std::span<double> result) -> void {
+    assert(a.size() == result.size() && b.size() == result.size());
+    for (auto i = 0; i < result.size(); i++) {
+      const auto max = std::max(a[i], b[i]);
+      const auto diff = max - std::min(a[i], b[i]);
+      const auto in_table = diff < JacobianLogTable::MAX_TOLERANCE;
+      result[i]
+        = max + (in_table ? JacobianLogTable::get(in_table ? diff : 0.0) : 0.0);
+    }
+  }
+
  private:
   struct JacobianLogTable {
     constexpr static auto MAX_TOLERANCE = 8.0;
@@ -238,10 +238,12 @@ namespace mirna {
      * - `aln.hits`: vector of alignment hits (for dilution factor)
      * - `aln.tail_pos`: position of tail start in read sequence (-1 if no tail)
      * @param aln Alignment record.
+     * @param count Number of reads sharing this alignment, e.g. the
+     * multiplicity of a collapsed unique sequence.
      * @return MirExp with one category and one length entry.
      * 
      * @details
-     * - Dilution factor: `1.0 / aln.hits.size()`
+     * - Dilution factor: `1.0 / aln.hits.size()`, scaled by `count`
      * - if tail exists: after `aln.tail_pos` is tail, classified by @ref tail_to_idx
      *   and recorded with length `aln.tail_pos`.
      * - if no tail: recorded as genome-matching (index 5) with length `aln.seq.size()`.
@@ -249,11 +251,11 @@ namespace mirna {
      * @warning Caller must ensure `aln.tail_pos` is valid.
      */
     template <class Aln>
-    static MirExp init_from_alignment(Aln&& aln) {
+    static MirExp init_from_alignment(Aln&& aln, double count = 1.0) {
       const auto dilute_factor = 1.0l / aln.hits.size();
       const auto has_tail = aln.tail_pos != -1;
-      const double exp = 1.0l * dilute_factor; 
-      auto mir_exp = MirExp{};
+      const double exp = count * dilute_factor; 
+      MirExp mir_exp{};
       auto tail_exp = TailExp{};
       mir_exp.value = exp;
 
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <biovoltron/file_io/sam.hpp>
+
+namespace biovoltron {
+
+/**
+ * @ingroup utility
+ * @brief A read whose clips are recorded as offsets instead of applied.
+ *
+ * The bases of the clipped read are seq[front, seq.size() - back) of the
+ * original record, which is neither copied nor changed. ReadClipper
+ * clips the view as it would the record, and materialize() builds the
+ * clipped SamRecord, copying each string once, when all clips are known.
+ *
+ * Example
+ * ```cpp
+ * auto read = ClippedRead<>{&record};
+ * ReadClipper::revert_soft_clipped_bases(read);
+ * ReadClipper::hard_clip_to_interval(read, interval);
+ * if (!MinimumLengthReadFilter{}(read))
+ *   reads.push_back(read.materialize());
+ * ```
+ *
+ * @tparam Encoded Whether the read is encoded (default is false).
+ */
+template<bool Encoded = false>
+struct ClippedRead {
+  /**
+   * The original read, which must outlive the view.
+   */
+  const SamRecord<Encoded>* read;
+
+  /**
+   * 1-based leftmost mapping position after the clips.
+   */
+  std::uint32_t pos = read->pos;
+
+  /**
+   * Reference length of the cigar after the clips.
+   */
+  std::uint32_t ref_size = read->cigar.ref_size();
+
+  /**
+   * Number of bases clipped off the front and the back of seq and qual.
+   */
+  std::uint32_t front{};
+  std::uint32_t back{};
+
+  /**
+   * Whether the soft clip at the front or the back of the cigar was
+   * turned into a match.
+   */
+  bool unclip_front{};
+  bool unclip_back{};
+
+  /**
+   * @return Number of bases left.
+   */
+  auto
+  size() const noexcept {
+    return read->seq.size() - front - back;
+  }
+
+  /**
+   * @return 0-based leftmost mapping position.
+   */
+  auto
+  begin() const noexcept {
+    return pos - 1;
+  }
+
+  /**
+   * @return 0-based position past the last aligned base.
+   */
+  auto
+  end() const noexcept {
+    return begin() + ref_size;
+  }
+
+  /**
+   * Build the clipped read.
+   */
+  auto
+  materialize() const {
+    auto record = SamRecord<Encoded>{};
+    record.header = read->header;
+    record.qname = read->qname;
+    record.flag = read->flag;
+    record.rname = read->rname;
+    record.pos = pos;
+    record.mapq = read->mapq;
+    record.cigar = read->cigar;
+    if (unclip_front)
+      record.cigar.front().op = 'M';
+    if (unclip_back)
+      record.cigar.back().op = 'M';
+    record.rnext = read->rnext;
+    record.pnext = read->pnext;
+    record.tlen = read->tlen;
+    record.seq.assign(read->seq, front, size());
+    record.qual.assign(read->qual, front, read->qual.size() - front - back);
+    record.optionals = read->optionals;
+    return record;
+  }
+};
+
+}  // namespace biovoltron
@@ -2,6 +2,7 @@
 #include <cassert>
 #include <biovoltron/file_io/sam.hpp>
 #include <biovoltron/utility/interval.hpp>
+#include <biovoltron/utility/read/clipped_read.hpp>
 
 namespace biovoltron {
 
@@ -108,6 +109,68 @@ struct ReadClipper {
       qual = qual.substr(0, qual.size() - clip_size);
     }
   }
+
+  /**
+   * Reverts soft-clipped bases of a read view, as the overload on
+   * SamRecord does, recording the clips as offsets.
+   *
+   * @tparam Encoded Whether the read is encoded (default is false).
+   * @param read The view of an unclipped read to modify.
+   */
+  template<bool Encoded = false>
+  static void
+  revert_soft_clipped_bases(ClippedRead<Encoded>& read) {
+    const auto& cigar = read.read->cigar;
+    auto [front_length, front_op] = cigar.front();
+    auto [back_length, back_op] = cigar.back();
+
+    if (read.read->read_reverse_strand()) {
+      if (front_op == 'S')
+        read.front += front_length;
+      if (back_op == 'S') {
+        read.unclip_back = true;
+        read.ref_size += back_length;
+      }
+    } else {
+      if (front_op == 'S' && read.begin() >= front_length) {
+        read.unclip_front = true;
+        read.ref_size += front_length;
+        read.pos -= front_length;
+        // A lone soft clip is the back of the cigar as well.
+        if (cigar.size() == 1)
+          back_op = 'M';
+      }
+      if (back_op == 'S')
+        read.back += back_length;
+    }
+  }
+
+  /**
+   * Hard clips a read view to fit within a specified interval, as the
+   * overload on SamRecord does, recording the clips as offsets.
+   *
+   * @tparam Encoded Whether the read is encoded (default is false).
+   * @param read The read view to modify.
+   * @param interval The interval to hard clip the read to.
+   */
+  template<bool Encoded = false>
+  static void
+  hard_clip_to_interval(ClippedRead<Encoded>& read, const Interval& interval) {
+    const auto& [contig, begin, end, strand] = interval;
+    assert(read.read->rname == contig);
+
+    auto alignment_begin = read.begin();
+    auto alignment_end = read.end();
+    if (alignment_begin < begin) {
+      auto clip_size = begin - alignment_begin;
+      if (clip_size > read.size())
+        clip_size = read.size();
+      read.front += clip_size;
+    }
+    // A clip longer than the bases left clips nothing.
+    if (alignment_end > end && alignment_end - end <= read.size())
+      read.back += alignment_end - end;
+  }
 };
 
 }  // namespace biovoltron
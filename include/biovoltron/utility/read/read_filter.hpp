@@ -1,6 +1,8 @@
 #pragma once
 #include <iostream>
 #include <biovoltron/file_io/sam.hpp>
+#include <biovoltron/utility/read/clipped_read.hpp>
+#include <tuple>
 
 namespace biovoltron {
 
@@ -88,6 +90,19 @@ struct MinimumLengthReadFilter {
   operator()(const SamRecord<Encoded>& record) const noexcept {
     return record.size() < MINIMUM_READ_LENGTH_AFTER_TRIMMING;
   }
+
+  /**
+   * Filters out clipped reads shorter than the minimum length.
+   *
+   * @tparam Encoded Whether the read is encoded (default is false).
+   * @param read The clipped read to check.
+   * @return True if the read is shorter than the minimum length, false otherwise.
+   */
+  template<bool Encoded = false>
+  auto
+  operator()(const ClippedRead<Encoded>& read) const noexcept {
+    return read.size() < MINIMUM_READ_LENGTH_AFTER_TRIMMING;
+  }
 };
 
 /**
@@ -109,4 +124,42 @@ struct MateOnSameContigReadFilter {
   }
 };
 
+/**
+ * @ingroup utility
+ * @brief Filter reads failing any of several filters, in one pass.
+ *
+ * The filters are tried in order until one rejects the read, so a
+ * single std::erase_if replaces one pass per filter.
+ *
+ * Example
+ * ```cpp
+ * constexpr auto filter = CompositeReadFilter{
+ *   MappingQualityReadFilter{}, DuplicateReadFilter{}};
+ * std::erase_if(reads, filter);
+ * ```
+ */
+template<class... Filters>
+struct CompositeReadFilter {
+  constexpr explicit CompositeReadFilter(Filters... filters)
+    : filters(filters...) {}
+
+  /**
+   * Filters out reads rejected by any of the filters.
+   *
+   * @tparam Encoded Whether the read is encoded (default is false).
+   * @param record The SAM record to check.
+   * @return True if any filter rejects the read, false otherwise.
+   */
+  template<bool Encoded = false>
+  auto
+  operator()(const SamRecord<Encoded>& record) const noexcept {
+    return std::apply(
+      [&](const auto&... filter) { return (filter(record) || ...); },
+      filters);
+  }
+
+ private:
+  std::tuple<Filters...> filters;
+};
+
 }  // namespace biovoltron
\ No newline at end of file
@@ -0,0 +1,210 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <concepts>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace biovoltron {
+
+/**
+ * @ingroup utility
+ * @brief A fixed team of workers for parallel loops.
+ *
+ * The threads are started once and sleep between loops, so a caller that
+ * runs a loop per batch does not start threads per batch. The thread
+ * that calls run() is worker 0 and the pool threads are workers 1 to
+ * size() - 1. Each worker runs one index at a time, so state indexed by
+ * the worker, such as a buffer, is reused from loop to loop without
+ * locking. run() must not be called from inside a loop of the same pool.
+ *
+ * Example
+ * ```cpp
+ * auto pool = ParallelForPool{4};
+ * auto sums = std::vector<long>(pool.size());
+ * for (auto batch = 0; batch < 10; batch++)
+ *   pool.run(1000, 16, [&](auto i, auto worker) { sums[worker] += i; });
+ * ```
+ */
+class ParallelForPool {
+ public:
+  /**
+   * @param threads Number of workers, the calling thread included, at
+   * least 1 is used.
+   */
+  explicit ParallelForPool(std::size_t threads)
+    : size_(std::max<std::size_t>(threads, 1)) {
+    try {
+      for (auto worker = std::size_t{1}; worker < size_; worker++)
+        threads_.emplace_back([this, worker] { serve(worker); });
+    } catch (...) {
+      stop();
+      throw;
+    }
+  }
+
+  ParallelForPool(const ParallelForPool&) = delete;
+  ParallelForPool& operator=(const ParallelForPool&) = delete;
+
+  ~ParallelForPool() { stop(); }
+
+  /**
+   * @return Number of workers, the calling thread included.
+   */
+  auto
+  size() const noexcept {
+    return size_;
+  }
+
+  /**
+   * @brief Run fn(i), or fn(i, worker), for every i in [0, n).
+   *
+   * Workers claim chunks of `chunk_size` indexes from a shared cursor, so
+   * uneven costs balance out and no index is run twice. No more workers
+   * than chunks take part. If fn throws, no further chunk is claimed,
+   * and the first exception is rethrown once every worker is done.
+   *
+   * @param n Number of indexes.
+   * @param chunk_size Indexes claimed at a time, at least 1 is used.
+   * @param fn Called with each index and the worker running it.
+   */
+  template <typename Fn>
+  auto
+  run(std::size_t n, std::size_t chunk_size, Fn&& fn) -> void {
+    chunk_size = std::max<std::size_t>(chunk_size, 1);
+    const auto chunk_cnt = (n + chunk_size - 1) / chunk_size;
+
+    auto next = std::atomic<std::size_t>{};
+    auto failed = std::atomic<bool>{};
+    auto error = std::exception_ptr{};
+    auto error_mutex = std::mutex{};
+    const auto work = [&](std::size_t worker) {
+      try {
+        for (auto begin = next.fetch_add(chunk_size); begin < n && !failed;
+             begin = next.fetch_add(chunk_size)) {
+          const auto end = std::min(begin + chunk_size, n);
+          for (auto i = begin; i < end; i++) {
+            if constexpr (std::invocable<Fn&, std::size_t, std::size_t>)
+              fn(i, worker);
+            else
+              fn(i);
+          }
+        }
+      } catch (...) {
+        const auto lock = std::scoped_lock{error_mutex};
+        if (!error) error = std::current_exception();
+        failed = true;
+      }
+    };
+    using Work = decltype(work);
+
+    const auto helpers = std::min(size_, std::max<std::size_t>(chunk_cnt, 1)) - 1;
+    if (helpers > 0) {
+      {
+        const auto lock = std::scoped_lock{mutex_};
+        task_ = &work;
+        call_ = [](const void* task, std::size_t worker) {
+          (*static_cast<const Work*>(task))(worker);
+        };
+        helpers_ = helpers;
+        pending_ = helpers;
+        generation_++;
+      }
+      start_cv_.notify_all();
+    }
+    work(0);
+    if (helpers > 0) {
+      auto lock = std::unique_lock{mutex_};
+      done_cv_.wait(lock, [&] { return pending_ == 0; });
+    }
+    if (error) std::rethrow_exception(error);
+  }
+
+ private:
+  // Wait for loops, and take part in those that need this worker.
+  auto
+  serve(std::size_t worker) -> void {
+    auto seen = std::uint64_t{};
+    while (true) {
+      auto task = static_cast<const void*>(nullptr);
+      auto call = static_cast<void (*)(const void*, std::size_t)>(nullptr);
+      {
+        auto lock = std::unique_lock{mutex_};
+        start_cv_.wait(lock, [&] { return stopping_ || generation_ != seen; });
+        if (stopping_) return;
+        seen = generation_;
+        if (worker > helpers_) continue;
+        task = task_;
+        call = call_;
+      }
+      call(task, worker);
+      {
+        const auto lock = std::scoped_lock{mutex_};
+        pending_--;
+      }
+      done_cv_.notify_one();
+    }
+  }
+
+  auto
+  stop() -> void {
+    {
+      const auto lock = std::scoped_lock{mutex_};
+      stopping_ = true;
+    }
+    start_cv_.notify_all();
+    for (auto& thread : threads_) thread.join();
+  }
+
+  std::size_t size_;
+  std::vector<std::thread> threads_;
+  std::mutex mutex_;
+  std::condition_variable start_cv_;
+  std::condition_variable done_cv_;
+  // The current loop, guarded by mutex_. Loop body of the workers
+  // 1 to helpers_, which have pending_ of them left to finish.
+  const void* task_{};
+  void (*call_)(const void*, std::size_t){};
+  std::size_t helpers_{};
+  std::size_t pending_{};
+  std::uint64_t generation_{};
+  bool stopping_{};
+};
+
+/**
+ * @ingroup utility
+ * @brief Run fn(i), or fn(i, worker), for every i in [0, n) on `threads`
+ * workers.
+ *
+ * Starts a ParallelForPool for this loop only, with no more workers than
+ * there are chunks, so a single chunk runs on the calling thread. Prefer
+ * a ParallelForPool when loops are run repeatedly.
+ *
+ * Example
+ * ```cpp
+ * auto squares = std::vector<int>(100);
+ * parallel_for(squares.size(), 4, 16, [&](auto i) { squares[i] = i * i; });
+ * ```
+ *
+ * @param n Number of indexes.
+ * @param threads Number of workers, at least 1 is used.
+ * @param chunk_size Indexes claimed at a time, at least 1 is used.
+ * @param fn Called with each index, from any worker.
+ * @throw The first exception thrown by fn, after every worker is done.
+ */
+template <typename Fn>
+auto
+parallel_for(std::size_t n, std::size_t threads, std::size_t chunk_size,
+             Fn&& fn) -> void {
+  chunk_size = std::max<std::size_t>(chunk_size, 1);
+  const auto chunk_cnt = (n + chunk_size - 1) / chunk_size;
+  auto pool = ParallelForPool{std::min(threads, std::max<std::size_t>(chunk_cnt, 1))};
+  pool.run(n, chunk_size, fn);
+}
+
+}  // namespace biovoltron
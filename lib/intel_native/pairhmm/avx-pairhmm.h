@@ -1,3 +1,6 @@
+#ifndef AVX_PAIRHMM_H
+#define AVX_PAIRHMM_H
+
 #include <cstdint>
 #include "pairhmm_common.h"
 #include "Context.h"
@@ -13,4 +16,6 @@
 
 #include "avx-functions-double.h"
 #include "avx-vector-shift.h"
-#include "avx-pairhmm-template.h"
\ No newline at end of file
+#include "avx-pairhmm-template.h"
+
+#endif // AVX_PAIRHMM_H
\ No newline at end of file
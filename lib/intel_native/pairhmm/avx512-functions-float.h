@@ -0,0 +1,121 @@
+#ifdef PRECISION
+#undef PRECISION
+#undef MAIN_TYPE
+#undef MAIN_TYPE_SIZE
+#undef UNION_TYPE
+#undef IF_128
+#undef IF_MAIN_TYPE
+#undef SHIFT_CONST1
+#undef SHIFT_CONST2
+#undef SHIFT_CONST3
+#undef _128_TYPE
+#undef SIMD_TYPE
+#undef _256_INT_TYPE
+#undef AVX_LENGTH
+#undef HAP_TYPE
+#undef MASK_TYPE
+#undef MASK_ALL_ONES
+#undef MASK_VEC
+
+#undef SET_VEC_ZERO
+#undef VEC_OR
+#undef VEC_ADD
+#undef VEC_SUB
+#undef VEC_MUL
+#undef VEC_DIV
+#undef VEC_BLEND
+#undef VEC_BLENDV
+#undef VEC_CAST_256_128
+#undef VEC_EXTRACT_128
+#undef VEC_EXTRACT_UNIT
+#undef VEC_SET1_VAL128
+#undef VEC_MOVE
+#undef VEC_CAST_128_256
+#undef VEC_INSERT_VAL
+#undef VEC_CVT_128_256
+#undef VEC_SET1_VAL
+#undef VEC_POPCVT_CHAR
+#undef VEC_LDPOPCVT_CHAR
+#undef VEC_CMP_EQ
+#undef VEC_SET_LSE
+#undef SHIFT_HAP
+#undef VEC_SSE_TO_AVX
+#undef VEC_SHIFT_LEFT_1BIT
+#undef COMPARE_VECS
+#undef BITMASK_VEC
+#undef VEC_SHIFT_IN
+#endif
+
+#define PRECISION s
+#define MAIN_TYPE float
+#define MAIN_TYPE_SIZE 32
+#define UNION_TYPE mix_F512
+#define SIMD_TYPE __m512
+#define AVX_LENGTH 16
+#define HAP_TYPE __m128i
+#define MASK_TYPE uint32_t
+#define MASK_ALL_ONES 0xFFFFFFFF
+#define MASK_VEC MaskVec_F512
+
+#define VEC_ADD(__v1, __v2)                     \
+    _mm512_add_ps(__v1, __v2)
+
+#define VEC_SUB(__v1, __v2)                     \
+    _mm512_sub_ps(__v1, __v2)
+
+#define VEC_MUL(__v1, __v2)                     \
+    _mm512_mul_ps(__v1, __v2)
+
+#define VEC_DIV(__v1, __v2)                     \
+    _mm512_div_ps(__v1, __v2)
+
+#define VEC_BLENDV(__distmChosen, __v1, __v2, __maskV)      \
+    __distmChosen = _mm512_mask_blend_ps(                     \
+        _mm512_movepi32_mask(_mm512_castps_si512(__maskV)), __v1, __v2);
+
+#define VEC_SET1_VAL(__val)                     \
+    _mm512_set1_ps(__val)
+
+#define VEC_POPCVT_CHAR(__ch)                   \
+    _mm512_cvtepi32_ps(_mm512_set1_epi32(__ch))
+
+#define VEC_SET_LSE(__val)                      \
+    _mm512_maskz_mov_ps(1, _mm512_set1_ps(__val))
+
+#define VEC_SSE_TO_AVX(__vsLow, __vsHigh, __vdst)       \
+    __vdst = _mm512_insertf32x8(_mm512_castps256_ps512(__vsLow), __vsHigh, 1) ;
+
+#define VEC_SHIFT_LEFT_1BIT(__vs)               \
+    __vs = _mm256_slli_epi32(__vs, 1)
+
+// Shift every lane up by one, moving __val into lane 0
+#define VEC_SHIFT_IN(__v, __val)                \
+    _mm512_castsi512_ps(_mm512_alignr_epi32(_mm512_castps_si512(__v), \
+        _mm512_castps_si512(_mm512_set1_ps(__val)), AVX_LENGTH - 1))
+
+class BitMaskVec_float512 {
+
+    MASK_VEC low_, high_ ;
+    SIMD_TYPE combined_ ;
+
+public:
+    inline MASK_TYPE& getLowEntry(int index) {
+        return low_.masks[index] ;
+    }
+    inline MASK_TYPE& getHighEntry(int index) {
+        return high_.masks[index] ;
+    }
+
+    inline const SIMD_TYPE& getCombinedMask() {
+        VEC_SSE_TO_AVX(low_.vecf, high_.vecf, combined_) ;
+        return combined_ ;
+    }
+
+    inline void shift_left_1bit() {
+        VEC_SHIFT_LEFT_1BIT(low_.vec) ;
+        VEC_SHIFT_LEFT_1BIT(high_.vec) ;
+    }
+
+} ;
+
+#define BITMASK_VEC BitMaskVec_float512
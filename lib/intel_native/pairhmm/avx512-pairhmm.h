@@ -0,0 +1,36 @@
+#ifndef AVX512_PAIRHMM_H
+#define AVX512_PAIRHMM_H
+
+#include <cstdint>
+#include "pairhmm_common.h"
+#include "Context.h"
+
+#include "avx-types.h"
+
+// The AVX-512 kernels are compiled for AVX-512 regardless of the global
+// target flags; callers check the CPU before calling them.
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx512f,avx512dq,avx512bw,avx512vl"))), apply_to=function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx512f,avx512dq,avx512bw,avx512vl")
+#endif
+
+#undef SIMD_ENGINE
+#define SIMD_ENGINE avx512
+
+#include "avx512-functions-float.h"
+#include "avx512-vector-shift.h"
+#include "avx-pairhmm-template.h"
+
+#include "avx512-functions-double.h"
+#include "avx512-vector-shift.h"
+#include "avx-pairhmm-template.h"
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+
+#endif // AVX512_PAIRHMM_H
\ No newline at end of file
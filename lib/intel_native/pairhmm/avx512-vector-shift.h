@@ -0,0 +1,18 @@
+#ifdef PRECISION
+
+inline void CONCAT(CONCAT(_vector_shift,SIMD_ENGINE), PRECISION) (UNION_TYPE &x, MAIN_TYPE shiftIn, MAIN_TYPE &shiftOut)
+{
+    /* extract x[AVX_LENGTH-1] */
+    shiftOut = x.f[AVX_LENGTH-1];
+    /* shift x up by one lane and move shiftIn to x[0] */
+    x.d = VEC_SHIFT_IN(x.d, shiftIn);
+}
+
+
+inline void CONCAT(CONCAT(_vector_shift_last,SIMD_ENGINE), PRECISION) (UNION_TYPE &x, MAIN_TYPE shiftIn)
+{
+    /* shift x up by one lane and move shiftIn to x[0] */
+    x.d = VEC_SHIFT_IN(x.d, shiftIn);
+}
+
+#endif
@@ -2,6 +2,7 @@
 #include <biovoltron/utility/haplotype/haplotype.hpp>
 #include <biovoltron/file_io/sam.hpp>
 #include <catch.hpp>
+#include <random>
 
 using namespace biovoltron;
 
@@ -96,3 +97,108 @@ TEST_CASE("PairHMM::compute_likelihoods - Computes likelihoods", "[PairHMM]") {
     for (auto j = 0; j < likelihoods[i].size(); j++)
       REQUIRE(likelihoods[i][j] == Approx(ans[i][j]));
 }
+
+TEST_CASE("PairHMM::compute_likelihoods - Backends agree", "[PairHMM]") {
+  auto gen = std::mt19937{7};
+  auto random_seq = [&](auto size) {
+    auto seq = std::string{};
+    for (auto i = 0; i < size; i++) seq += "ACGT"[gen() % 4];
+    return seq;
+  };
+
+  auto haplotypes = std::vector<Haplotype>(4);
+  const auto ref = random_seq(300);
+  for (auto& haplotype : haplotypes) {
+    haplotype.seq = ref;
+    for (auto i = 0; i < 3; i++) haplotype.seq[gen() % ref.size()] = 'T';
+  }
+  haplotypes[1].seq.insert(120, "GA");
+  haplotypes[2].seq.erase(80, 3);
+  haplotypes[3].seq[40] = 'N';
+
+  auto reads = std::vector<SamRecord<>>{};
+  for (auto i = 0; i < 40; i++) {
+    const auto& haplotype = haplotypes[i % haplotypes.size()].seq;
+    auto read = make_sam_record(haplotype.substr(gen() % 150, 50 + gen() % 100));
+    read.seq[10] = i % 3 ? read.seq[10] : 'N';
+    // Sequencing errors keep the reads past filter_poorly_modeled_reads.
+    for (const auto pos : {20, 40}) read.seq[pos] = read.seq[pos] == 'A' ? 'C' : 'A';
+    for (auto& qual : read.qual) qual = 33 + 10 + gen() % 30;
+    reads.push_back(read);
+  }
+  // Unrelated to every haplotype, so the float kernels underflow and the
+  // double kernels take over.
+  reads.push_back(make_sam_record(random_seq(250)));
+
+  auto scalar_reads = reads;
+  const auto expected = PairHMM{.backend = PairHMM::Backend::SCALAR}
+                          .compute_likelihoods(haplotypes, scalar_reads);
+  for (const auto backend : {PairHMM::Backend::AVX2, PairHMM::Backend::AVX512}) {
+    if (!PairHMM::is_supported(backend))
+      continue;
+    auto backend_reads = reads;
+    const auto likelihoods = PairHMM{.backend = backend}
+                               .compute_likelihoods(haplotypes, backend_reads);
+    REQUIRE(backend_reads.size() == scalar_reads.size());
+    REQUIRE(likelihoods.size() == expected.size());
+    for (auto i = 0; i < likelihoods.size(); i++)
+      for (auto j = 0; j < likelihoods[i].size(); j++)
+        REQUIRE(likelihoods[i][j] == Approx(expected[i][j]).margin(1e-3));
+  }
+  CHECK(PairHMM::is_supported(PairHMM{}.backend));
+}
+
+TEST_CASE("PairHMM::compute_likelihoods - Reuses shared haplotype prefixes", "[PairHMM]") {
+  auto gen = std::mt19937{11};
+  auto ref = std::string{};
+  for (auto i = 0; i < 200; i++) ref += "ACGT"[gen() % 4];
+
+  // Haplotypes diverging at different columns, a duplicate and one of
+  // another length.
+  auto haplotypes = std::vector<Haplotype>(6);
+  for (auto& haplotype : haplotypes) haplotype.seq = ref;
+  haplotypes[1].seq[150] = haplotypes[1].seq[150] == 'A' ? 'C' : 'A';
+  haplotypes[2].seq[60] = haplotypes[2].seq[60] == 'A' ? 'C' : 'A';
+  haplotypes[3].seq = haplotypes[1].seq;
+  haplotypes[4].seq[60] = haplotypes[2].seq[60];
+  haplotypes[4].seq[170] = haplotypes[4].seq[170] == 'A' ? 'C' : 'A';
+  haplotypes[5].seq.erase(100, 2);
+
+  auto reads = std::vector<SamRecord<>>{};
+  for (auto begin = 0; begin < 100; begin += 10) {
+    auto read = make_sam_record(ref.substr(begin, 100));
+    for (const auto pos : {20, 40}) read.seq[pos] = read.seq[pos] == 'A' ? 'C' : 'A';
+    reads.push_back(read);
+  }
+
+  const auto scalar = PairHMM{.backend = PairHMM::Backend::SCALAR};
+  auto sorted_reads = reads;
+  const auto likelihoods = scalar.compute_likelihoods(haplotypes, sorted_reads);
+  REQUIRE(likelihoods.size() == reads.size());
+  for (const auto& read_likelihoods : likelihoods)
+    CHECK(read_likelihoods[3] == read_likelihoods[1]);
+
+  // Reversing the haplotypes changes which prefixes are reused, not the
+  // likelihoods.
+  auto reversed = haplotypes;
+  std::ranges::reverse(reversed);
+  auto reversed_reads = reads;
+  const auto reversed_likelihoods
+    = scalar.compute_likelihoods(reversed, reversed_reads);
+  for (auto i = 0; i < likelihoods.size(); i++)
+    for (auto j = 0; j < haplotypes.size(); j++)
+      CHECK(reversed_likelihoods[i][haplotypes.size() - 1 - j]
+            == likelihoods[i][j]);
+
+  // Evaluated alone, a haplotype reuses nothing; capping those
+  // likelihoods as normalize_likelihoods does gives the same values.
+  auto alone = std::vector(reads.size(), std::vector<double>{});
+  for (const auto& haplotype : haplotypes) {
+    auto alone_reads = reads;
+    const auto likelihood = scalar.compute_likelihoods({haplotype}, alone_reads);
+    REQUIRE(likelihood.size() == reads.size());
+    for (auto i = 0; i < reads.size(); i++) alone[i].push_back(likelihood[i][0]);
+  }
+  PairHMM::normalize_likelihoods(alone);
+  CHECK(alone == likelihoods);
+}
@@ -0,0 +1,58 @@
+#include <biovoltron/algo/align/inexact_match/pairhmm_job_queue.hpp>
+#include <catch.hpp>
+#include <random>
+
+using namespace biovoltron;
+
+TEST_CASE("PairHMMJobQueue - Runs jobs of several windows as one batch", "[PairHMMJobQueue]") {
+  auto gen = std::mt19937{5};
+  auto random_seq = [&](auto size) {
+    auto seq = std::string{};
+    for (auto i = 0; i < size; i++) seq += "ACGT"[gen() % 4];
+    return seq;
+  };
+  // Reads with two errors each, so that filter_poorly_modeled_reads
+  // keeps them.
+  auto make_window = [&](auto haplotype_cnt, auto read_cnt, auto read_size) {
+    const auto ref = random_seq(read_size + 50);
+    auto haplotypes = std::vector<Haplotype>(haplotype_cnt);
+    for (auto& haplotype : haplotypes) {
+      haplotype.seq = ref;
+      haplotype.seq[gen() % ref.size()] = 'T';
+    }
+    auto reads = std::vector<SamRecord<>>{};
+    for (auto i = 0; i < read_cnt; i++) {
+      auto read = SamRecord<>{};
+      read.seq = haplotypes[i % haplotype_cnt].seq.substr(gen() % 50, read_size);
+      for (const auto pos : {5, 15}) read.seq[pos] = read.seq[pos] == 'A' ? 'C' : 'A';
+      read.qual = std::string(read.seq.size(), ';');
+      reads.push_back(read);
+    }
+    return std::pair{haplotypes, reads};
+  };
+
+  const auto backend = GENERATE(PairHMM::Backend::SCALAR, PairHMM::fastest_backend());
+  const auto pairhmm = PairHMM{.backend = backend};
+  auto windows = std::vector{make_window(2, 5, 60), make_window(4, 12, 150),
+                             make_window(3, 1, 100)};
+
+  auto jobs = PairHMMJobQueue{pairhmm};
+  auto ids = std::vector<std::size_t>{};
+  for (const auto& [haplotypes, reads] : windows)
+    ids.push_back(jobs.push(haplotypes, reads));
+  REQUIRE(jobs.schedule() == 18);
+  auto workspace = PairHMM::Workspace{};
+  for (auto task = 0; task < 18; task++) jobs.run(task, workspace);
+
+  for (auto i = 0; i < windows.size(); i++) {
+    auto& [haplotypes, reads] = windows[i];
+    auto expected_reads = reads;
+    const auto expected = pairhmm.compute_likelihoods(haplotypes, expected_reads);
+    const auto likelihoods = jobs.take(ids[i], reads);
+    REQUIRE_FALSE(likelihoods.empty());
+    CHECK(likelihoods == expected);
+    REQUIRE(reads.size() == expected_reads.size());
+    for (auto j = 0; j < reads.size(); j++)
+      CHECK(reads[j].seq == expected_reads[j].seq);
+  }
+}
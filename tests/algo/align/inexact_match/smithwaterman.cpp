@@ -120,4 +120,17 @@ TEST_CASE("SmithWaterman::align - Performs Smith-Waterman alignment", "[SmithWat
   
     //std::cout << "SmithWaterman_mix time: " << duration << " us" << std::endl;
   }
+
+  SECTION("Workspace reuse")
+  {
+    // Alignments of different sizes through one workspace match fresh ones.
+    auto workspace = SmithWaterman::Workspace{};
+    auto long_alt = alt;
+    long_alt.erase(long_alt.begin() + 60);
+    long_alt.insert(90, "TTT");
+    for (const auto& [r, a] : {std::pair{ref, long_alt},
+                               std::pair{ref.substr(30, 80), alt.substr(35, 60)},
+                               std::pair{ref, long_alt}})
+      CHECK(SmithWaterman::align(r, a, workspace) == SmithWaterman::align(r, a));
+  }
 }
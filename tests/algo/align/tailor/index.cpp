@@ -1,4 +1,5 @@
 #include <biovoltron/algo/align/tailor/index.hpp>
+#include <filesystem>
 #include <catch.hpp>
 
 namespace ranges = std::ranges;
@@ -104,3 +105,50 @@ TEST_CASE("Index::build - Builds, saves, and loads a Tailor index", "[Index]") {
     REQUIRE_THROWS_WITH(index.get_chr_size("gg"), "Chromosome is not in the index.");
   }
 }
+
+TEST_CASE("Index::select - Finds the k-th occurrence of a symbol in the BWT", "[Index]") {
+  // Long enough for several select samples and a partial last word.
+  auto seq = std::string{};
+  for (auto i = 0u, x = 12345u; i < 5003; i++) {
+    x = x * 1103515245 + 12345;
+    seq += "ACGT"[(x >> 16) % (i % 700 < 350 ? 4 : 2)];
+  }
+  auto ref = std::vector<FastaRecord<>>{{"chr1", seq.substr(0, 2000)}, {"chr2", seq.substr(2000)}};
+
+  auto index = Index{5};
+  index.make_index(ref);
+  REQUIRE(index.has_select());
+
+  for (auto c = std::int8_t{}; c < 4; c++) {
+    auto k = std::uint32_t{};
+    for (auto i = std::uint32_t{}; i < index.get_bwt_size(); i++) {
+      if (index.bwt_[i] != c || i == index.pri_)
+        continue;
+      REQUIRE(index.get_occ_value(c, i) == k);
+      REQUIRE(index.select(c, k) == i);
+      k++;
+    }
+    CHECK(k == index.get_occ_value(c, index.get_bwt_size()));
+  }
+
+  SECTION("Select samples are optional and rebuilt on load") {
+    auto plain = Index{5, false};
+    plain.make_index(ref);
+    CHECK_FALSE(plain.has_select());
+
+    const auto path = std::filesystem::temp_directory_path() / "tailor_select.idx";
+    {
+      auto ofs = std::ofstream{path};
+      index.save(ofs);
+    }
+    auto loaded = Index{};
+    {
+      auto ifs = std::ifstream{path};
+      loaded.load(ifs);
+    }
+    REQUIRE(loaded.has_select());
+    for (auto k = std::uint32_t{}; k < index.get_occ_value(2, index.get_bwt_size()); k += 7)
+      CHECK(loaded.select(2, k) == index.select(2, k));
+    std::filesystem::remove(path);
+  }
+}
@@ -0,0 +1,139 @@
+#include <biovoltron/algo/align/tailor/index_file.hpp>
+#include <biovoltron/algo/align/tailor/tailor.hpp>
+#include <catch.hpp>
+
+namespace ranges = std::ranges;
+using namespace biovoltron;
+
+TEST_CASE("TailorIndexFile - Saves and maps a Tailor index pair", "[TailorIndexFile]") {
+  auto ref = std::vector<FastaRecord<>>{
+    {"chr1", "CGATCGATCGATGCATCGATAGGGTAGCTAGCTATTAAGAGCTCTCTATGAGATGCTAGACGTATGCATGAGTCCGTATCATATGCTAGCTGAGTCGTACGTAGGGGG"},
+    {"chr2", "TAGGTTTTAGTGATCTATAGAGAAAGAAGATCTCTCCGCGCGTATACTCGTCGGCGTCATATCGACGTATATATGCGCATCATATCGAGTCGATATCC"},
+    {"chr3", "CGATTAGGCCGATATAGCGGCGCGCCCTCTTAGAGGGATTCGAATTAGATATATTAGGGGGTTATGCAGCATCGCTTAGCTGCCGGCGCG"}
+  };
+  auto rc_ref = ref;
+  for (auto& record : rc_ref)
+    record.seq = Codec::rev_comp(record.seq);
+
+  auto index = Index{5};
+  index.make_index(ref);
+  auto rc_index = Index{5};
+  rc_index.make_index(rc_ref);
+  const auto pair_path = std::filesystem::temp_directory_path() / "tailor_pair.tidx";
+  const auto plain_path = std::filesystem::temp_directory_path() / "tailor_plain.tidx";
+  const auto bad_path = std::filesystem::temp_directory_path() / "tailor_bad.tidx";
+  TailorIndexFile::save(pair_path, index, rc_index);
+
+  const auto same_index = [](const auto& lhs, const auto& rhs) {
+    CHECK(lhs.LOOKUP_LEN == rhs.LOOKUP_LEN);
+    CHECK(lhs.cnt_ == rhs.cnt_);
+    CHECK(lhs.pri_ == rhs.pri_);
+    CHECK(lhs.bwt_ == rhs.bwt_);
+    CHECK(lhs.occ_ == rhs.occ_);
+    CHECK(lhs.sa_ == rhs.sa_);
+    CHECK(lhs.lookup_ == rhs.lookup_);
+    REQUIRE(lhs.chr_bounds.size() == rhs.chr_bounds.size());
+    for (auto i = 0; i < lhs.chr_bounds.size(); i++) {
+      CHECK(lhs.chr_bounds[i].chrom == rhs.chr_bounds[i].chrom);
+      CHECK(lhs.chr_bounds[i].last_elem_pos == rhs.chr_bounds[i].last_elem_pos);
+    }
+  };
+
+  SECTION("Loaded indexes equal the saved ones") {
+    const auto [fmi, rc_fmi] = TailorIndexFile::load(pair_path);
+    same_index(fmi, index);
+    same_index(rc_fmi, rc_index);
+    CHECK(fmi.has_select());
+    CHECK_FALSE(TailorIndexFile::load(pair_path, false).first.has_select());
+    for (auto c = 0; c < 4; c++) {
+      const auto occurrences = fmi.get_occ_value(c, fmi.bwt_.size());
+      for (auto k = 0u; k < occurrences; k++)
+        CHECK(fmi.select(c, k) == index.select(c, k));
+    }
+
+    auto plain = Index{5, false};
+    plain.make_index(ref);
+    TailorIndexFile::save(plain_path, plain, plain);
+    const auto rebuilt = TailorIndexFile::load(plain_path).first;
+    REQUIRE(rebuilt.has_select());
+    CHECK(rebuilt.select(2, 3) == index.select(2, 3));
+
+    auto tailor = Tailor{fmi, rc_fmi};
+    auto expected = Tailor{index, rc_index};
+    auto read = FastqRecord<>{};
+    read.name = "read";
+    read.seq = ref[1].seq.substr(30, 22) + "AAA";
+    read.qual = std::string(read.seq.size(), 'I');
+    const auto aln = tailor.search(read);
+    REQUIRE(aln.first.hits.size() == 1);
+    CHECK(aln.first.hits.front().intv == Interval{"chr2", 30, 52});
+    CHECK(aln_to_sam_list(aln.first) == aln_to_sam_list(expected.search(read).first));
+  }
+
+  SECTION("Sections are aligned in a self-describing layout") {
+    auto fin = std::ifstream{pair_path, std::ios::binary};
+    auto header = TailorIndexFile::Header{};
+    fin.read(reinterpret_cast<char*>(&header), sizeof(header));
+    CHECK(header.magic == TailorIndexFile::MAGIC);
+    CHECK(header.version == TailorIndexFile::VERSION);
+    CHECK(header.lookup_len == 5);
+    CHECK(header.file_bytes == std::filesystem::file_size(pair_path));
+    REQUIRE(header.section_count == 22);
+    auto sections = std::vector<TailorIndexFile::Section>(header.section_count);
+    fin.read(reinterpret_cast<char*>(sections.data()), sections.size() * sizeof(sections[0]));
+    for (const auto& section : sections) {
+      CHECK(section.offset % TailorIndexFile::ALIGNMENT == 0);
+      CHECK(section.offset + section.bytes <= header.file_bytes);
+    }
+  }
+
+  SECTION("Corrupted files are rejected") {
+    const auto corrupt = [&](std::uint64_t offset, std::string_view bytes) {
+      std::filesystem::copy_file(pair_path, bad_path,
+        std::filesystem::copy_options::overwrite_existing);
+      auto fs = std::fstream{bad_path, std::ios::binary | std::ios::in | std::ios::out};
+      fs.seekp(offset);
+      fs.write(bytes.data(), bytes.size());
+    };
+    auto fin = std::ifstream{pair_path, std::ios::binary};
+    auto header = TailorIndexFile::Header{};
+    fin.read(reinterpret_cast<char*>(&header), sizeof(header));
+    auto section = TailorIndexFile::Section{};
+    fin.read(reinterpret_cast<char*>(&section), sizeof(section));
+
+    corrupt(0, "XX");
+    CHECK_THROWS_WITH(TailorIndexFile::load(bad_path), Catch::Contains("bad magic"));
+
+    corrupt(offsetof(TailorIndexFile::Header, lookup_len), "\x07");
+    CHECK_THROWS_WITH(TailorIndexFile::load(bad_path), Catch::Contains("header checksum"));
+
+    corrupt(section.offset + 3, "\xff");
+    CHECK_THROWS_WITH(TailorIndexFile::load(bad_path, true, true),
+      Catch::Contains("section checksum"));
+    CHECK_NOTHROW(TailorIndexFile::load(bad_path));
+
+    // A count that disagrees with the section size is rejected before
+    // anything is allocated, even under a recomputed table checksum.
+    auto sections = std::vector<TailorIndexFile::Section>(header.section_count);
+    fin.seekg(sizeof(header));
+    fin.read(reinterpret_cast<char*>(sections.data()), sections.size() * sizeof(sections[0]));
+    sections.front().count = std::uint64_t{1} << 60;
+    auto forged = header;
+    forged.checksum = TailorIndexFile::header_checksum(forged, sections);
+    auto table = std::string(reinterpret_cast<const char*>(&forged), sizeof(forged));
+    table.append(reinterpret_cast<const char*>(sections.data()),
+                 sections.size() * sizeof(sections[0]));
+    corrupt(0, table);
+    CHECK_THROWS_WITH(TailorIndexFile::load(bad_path), Catch::Contains("section size mismatch"));
+
+    std::filesystem::resize_file(bad_path, header.file_bytes / 2);
+    CHECK_THROWS_WITH(TailorIndexFile::load(bad_path), Catch::Contains("truncated"));
+
+    CHECK_THROWS_WITH(TailorIndexFile::load<4>(pair_path), Catch::Contains("SA_INTV"));
+    CHECK_THROWS(TailorIndexFile::load("no_such_file.tidx"));
+  }
+
+  std::filesystem::remove(pair_path);
+  std::filesystem::remove(plain_path);
+  std::filesystem::remove(bad_path);
+}
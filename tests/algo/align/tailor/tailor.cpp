@@ -2,7 +2,9 @@
 #include <biovoltron/utility/istring.hpp>
 #include <biovoltron/file_io/fasta.hpp> 
 #include <biovoltron/file_io/fastq.hpp> 
+#include <biovoltron/utility/expression/mirna/mirna_exp.hpp>
 #include <catch.hpp>
+#include <numeric>
 #include <string>
 
 namespace ranges = std::ranges;
@@ -355,6 +357,29 @@ SCENARIO("Tailor::search - Handles single matches", "[Tailor]") {
         CHECK(aln.hits.size() == 0);
       }
     }
+
+    WHEN("The indexes are built without select samples") {
+      auto plain_index = Index{5, false};
+      plain_index.make_index(ref);
+      auto plain_rc_index = Index{5, false};
+      plain_rc_index.make_index(rc_ref);
+      auto plain = Tailor{plain_index, plain_rc_index};
+      plain.allow_seed_mismatch = true;
+
+      THEN("Extension falls back to binary search with the same result") {
+        for (auto len = 5; len <= 8; len++) {
+          tailor.max_5adapter_len = len;
+          plain.max_5adapter_len = len;
+          const auto aln = tailor.search_with_extend5(read);
+          const auto expected = plain.search_with_extend5(read);
+          CHECK(aln.head_pos == expected.head_pos);
+          CHECK(aln.tail_pos == expected.tail_pos);
+          REQUIRE(aln.hits.size() == expected.hits.size());
+          for (auto i = 0; i < aln.hits.size(); i++)
+            CHECK(aln.hits[i].intv == expected.hits[i].intv);
+        }
+      }
+    }
   }
 }
 
@@ -636,3 +661,284 @@ SCENARIO("Tailor::search - Handles multiple matches", "[Tailor]") {
     }
   }
 }
+
+SCENARIO("Tailor::search - Converts C back to T guided by the index", "[Tailor]") {
+  auto ref = std::vector<FastaRecord<>>{
+    {"chr1", "CGATCGATCGATGCATCGATAGGGTAGCTAGCTATTAAGAGCTCTCTATGAGATGCTAGACGTATGCATGAGTCCGTATCATATGCTAGCTGAGTCGTACGTAGGGGG"}, 
+    {"chr2", "TAGGTTTTAGTGATCTATAGAGAAAGAAGATCTCTCCGCGCGTATACTCGTCGGCGTCATATCGACGTATATATGCGCATCATATCGAGTCGATATCC"}, 
+    {"chr3", "CGATTAGGCCGATATAGCGGCGCGCCCTCTTAGAGGGATTCGAATTAGATATATTAGGGGGTTATGCAGCATCGCTTAGCTGCCGGCGCG"}
+  };
+
+  auto index = Index{5};
+  index.make_index(ref);
+
+  auto rc_ref = ref;
+  for (auto& record : rc_ref)
+    record.seq = Codec::rev_comp(record.seq);
+  auto rc_index = Index{5};
+  rc_index.make_index(rc_ref);
+
+  // Reads with 1 to 4 T>C conversions, some of them on the reverse strand.
+  auto reads = std::vector<FastqRecord<>>{};
+  for (auto i = 0; i < 300; i++) {
+    auto read = FastqRecord<>{};
+    read.name = "read" + std::to_string(i);
+    read.seq = ref[i % ref.size()].seq.substr(i % 60, 20 + i % 6);
+    if (i % 4 == 3) read.seq = Codec::rev_comp(read.seq);
+    for (auto j = 0, converted = 0; j < read.seq.size() && converted <= i % 4; j++)
+      if (read.seq[j] == 'T' && (i + j) % 3 == 0) {
+        read.seq[j] = 'C';
+        converted++;
+      }
+    read.qual = std::string(read.seq.size(), 'I');
+    reads.emplace_back(std::move(read));
+  }
+
+  // Converts combinations of Cs in the same order as Tailor (fewest first,
+  // then by position) and keeps the first one which aligns.
+  auto brute_force = [](const auto& plain, FastqRecord<> read, int budget) {
+    auto pos = std::vector<std::uint32_t>{};
+    for (auto i = 0; i < read.seq.size(); i++)
+      if (read.seq[i] == 'C') pos.push_back(i);
+    for (auto k = 1; k <= budget && k <= pos.size(); k++) {
+      auto list = std::string(k, 1);
+      list.resize(pos.size(), 0);
+      do {
+        auto converted = read;
+        auto tc_set = std::set<std::uint32_t>{};
+        for (auto j = 0; j < list.size(); j++)
+          if (list[j] == 1) {
+            converted.seq[pos[j]] = 'T';
+            tc_set.insert(pos[j]);
+          }
+        auto aln = plain.search(converted);
+        if (!aln.first.hits.empty() || !aln.second.hits.empty())
+          return std::tuple(std::move(aln), tc_set);
+      } while (ranges::prev_permutation(list).found);
+    }
+    return std::tuple(std::pair<Alignment, Alignment>{}, std::set<std::uint32_t>{});
+  };
+
+  auto same_hits = [](const Alignment& c2t, const Alignment& expected,
+                      const std::set<std::uint32_t>& tc_set) {
+    REQUIRE(c2t.hits.size() == expected.hits.size());
+    CHECK(c2t.tail_pos == expected.tail_pos);
+    for (auto i = 0; i < c2t.hits.size(); i++) {
+      CHECK(c2t.hits[i].intv == expected.hits[i].intv);
+      CHECK(c2t.hits[i].mismatches.size() == expected.hits[i].mismatches.size());
+      CHECK(c2t.hits[i].tc_set == tc_set);
+    }
+  };
+
+  for (const auto allow_seed_mismatch : {false, true})
+  for (const auto budget : {3, 4}) {
+    WHEN("allow_seed_mismatch is " + std::to_string(allow_seed_mismatch)
+         + " with up to " + std::to_string(budget) + " conversions") {
+      auto plain = Tailor{index, rc_index};
+      plain.allow_seed_mismatch = allow_seed_mismatch;
+      auto tailor = plain;
+      tailor.enable_c2t = true;
+      tailor.max_c2t_conversions = budget;
+
+      THEN("Hits equal the first aligning combination of conversions") {
+        auto converted = 0;
+        auto most_conversions = std::size_t{};
+        for (const auto& read : reads) {
+          const auto aln = tailor.search(read);
+          if (!plain.search(read).first.hits.empty()
+              || !plain.search(read).second.hits.empty())
+            continue;
+          const auto [expected, tc_set] = brute_force(plain, read, budget);
+          same_hits(aln.first, expected.first, tc_set);
+          same_hits(aln.second, expected.second, tc_set);
+          converted += !tc_set.empty();
+          most_conversions = std::max(most_conversions, tc_set.size());
+        }
+        CHECK(converted > 50);
+        CHECK(most_conversions <= budget);
+        // A seed mismatch can stand in for the last conversion.
+        if (!allow_seed_mismatch)
+          CHECK(most_conversions == budget);
+      }
+    }
+  }
+}
+
+SCENARIO("Tailor::search_batch - Aligns reads in parallel", "[Tailor]") {
+  auto ref = std::vector<FastaRecord<>>{
+    {"chr1", "CGATCGATCGATGCATCGATAGGGTAGCTAGCTATTAAGAGCTCTCTATGAGATGCTAGACGTATGCATGAGTCCGTATCATATGCTAGCTGAGTCGTACGTAGGGGG"}, 
+    {"chr2", "TAGGTTTTAGTGATCTATAGAGAAAGAAGATCTCTCCGCGCGTATACTCGTCGGCGTCATATCGACGTATATATGCGCATCATATCGAGTCGATATCC"}, 
+    {"chr3", "CGATTAGGCCGATATAGCGGCGCGCCCTCTTAGAGGGATTCGAATTAGATATATTAGGGGGTTATGCAGCATCGCTTAGCTGCCGGCGCG"}
+  };
+
+  auto index = Index{5};
+  index.make_index(ref);
+
+  auto rc_ref = ref;
+  for (auto& record : rc_ref)
+    record.seq = Codec::rev_comp(record.seq);
+  auto rc_index = Index{5};
+  rc_index.make_index(rc_ref);
+
+  const auto tailor = [&] {
+    auto tailor = Tailor{index, rc_index};
+    tailor.allow_seed_mismatch = true;
+    return tailor;
+  };
+
+  // Exact, tailed, mismatched, reverse, too short and unmappable reads.
+  auto reads = std::vector<FastqRecord<>>{};
+  for (auto i = 0; i < 500; i++) {
+    const auto& chr = ref[i % ref.size()].seq;
+    auto read = FastqRecord<>{};
+    read.name = "read" + std::to_string(i);
+    read.seq = chr.substr(i % 50, 20 + i % 7);
+    if (i % 3 == 1) read.seq += "AAAA";
+    if (i % 5 == 2) read.seq[10] = Codec::comp(read.seq[10]);
+    if (i % 4 == 3) read.seq = Codec::rev_comp(read.seq);
+    if (i % 11 == 0) read.seq = read.seq.substr(0, 10);
+    if (i % 13 == 0) read.seq = std::string(25, 'A');
+    read.qual = std::string(read.seq.size(), 'I');
+    reads.emplace_back(std::move(read));
+  }
+
+  WHEN("Searching with several threads and small chunks") {
+    const auto aligner = tailor();
+    const auto results = aligner.search_batch(reads, 4, 16);
+
+    THEN("Results equal serial search, in input order") {
+      REQUIRE(results.size() == reads.size());
+      for (auto i = 0; i < reads.size(); i++) {
+        const auto expected = aligner.search(reads[i]);
+        CHECK(results[i].first.name == expected.first.name);
+        CHECK(results[i].first.tail_pos == expected.first.tail_pos);
+        CHECK(aln_to_sam_list(results[i].first) == aln_to_sam_list(expected.first));
+        CHECK(aln_to_sam_list(results[i].second) == aln_to_sam_list(expected.second));
+      }
+    }
+  }
+
+  WHEN("The batch is empty") {
+    const auto aligner = tailor();
+    THEN("No result") {
+      CHECK(aligner.search_batch(std::vector<FastqRecord<>>{}, 4).empty());
+    }
+  }
+
+  WHEN("Extending 5' on a const Tailor") {
+    auto aligner = tailor();
+    aligner.max_5adapter_len = 7;
+    const auto& const_aligner = aligner;
+    auto read = FastqRecord<>{};
+    read.name = "read";
+    read.seq = "AGTACCC" + ref[0].seq.substr(21, 32);
+    read.qual = std::string(read.seq.size(), 'I');
+    const auto aln = const_aligner.search_with_extend5(read);
+    THEN("Range tables were built at construction") {
+      CHECK(aln.head_pos == 7);
+      REQUIRE(aln.hits.size() == 1);
+      CHECK(aln.hits.front().intv == Interval{"chr1", 21, 53});
+    }
+  }
+}
+
+SCENARIO("Tailor::search_collapsed - Aligns each distinct sequence once", "[Tailor]") {
+  auto ref = std::vector<FastaRecord<>>{
+    {"chr1", "CGATCGATCGATGCATCGATAGGGTAGCTAGCTATTAAGAGCTCTCTATGAGATGCTAGACGTATGCATGAGTCCGTATCATATGCTAGCTGAGTCGTACGTAGGGGG"}, 
+    {"chr2", "TAGGTTTTAGTGATCTATAGAGAAAGAAGATCTCTCCGCGCGTATACTCGTCGGCGTCATATCGACGTATATATGCGCATCATATCGAGTCGATATCC"}
+  };
+
+  auto index = Index{5};
+  index.make_index(ref);
+
+  auto rc_ref = ref;
+  for (auto& record : rc_ref)
+    record.seq = Codec::rev_comp(record.seq);
+  auto rc_index = Index{5};
+  rc_index.make_index(rc_ref);
+
+  auto tailor = Tailor{index, rc_index};
+  tailor.allow_seed_mismatch = true;
+
+  // 6 distinct sequences, including a short one and one with 'N'.
+  const auto seqs = std::vector<std::string>{
+    ref[0].seq.substr(2, 22),
+    ref[0].seq.substr(2, 22) + "AAA",
+    Codec::rev_comp(ref[1].seq.substr(10, 24)),
+    ref[1].seq.substr(30, 21),
+    "ACGTACG",
+    "NNNN" + ref[0].seq.substr(40, 20)
+  };
+  auto reads = std::vector<FastqRecord<>>{};
+  for (auto i = 0; i < 300; i++) {
+    auto read = FastqRecord<>{};
+    read.name = "read" + std::to_string(i);
+    read.seq = seqs[i % 7 % seqs.size()];
+    read.qual = std::string(read.seq.size(), 'A' + i % 20);
+    reads.emplace_back(std::move(read));
+  }
+
+  WHEN("Collapsing the batch") {
+    const auto collapsed = tailor.search_collapsed(reads, 4, 8);
+
+    THEN("Each distinct sequence is counted") {
+      REQUIRE(collapsed.alignments.size() == seqs.size());
+      CHECK(std::accumulate(collapsed.counts.begin(), collapsed.counts.end(), 0u) == reads.size());
+      CHECK(collapsed.collapse_ratio() == Approx(300.0 / seqs.size()));
+      CHECK(collapsed.unique_ids.front() == 0);
+      CHECK(collapsed.alignments.front().first.name == "read0");
+    }
+
+    THEN("Expanded results equal per-read search") {
+      const auto results = collapsed.expand(reads);
+      REQUIRE(results.size() == reads.size());
+      for (auto i = 0; i < reads.size(); i++) {
+        const auto expected = tailor.search(reads[i]);
+        CHECK(results[i].first.name == expected.first.name);
+        CHECK(results[i].first.seq == expected.first.seq);
+        CHECK(results[i].first.qual == expected.first.qual);
+        CHECK(aln_to_sam_list(results[i].first) == aln_to_sam_list(expected.first));
+        CHECK(aln_to_sam_list(results[i].second) == aln_to_sam_list(expected.second));
+      }
+    }
+
+    THEN("Reads without qualities get their names back") {
+      auto unqualified = reads;
+      for (auto& read : unqualified) read.qual.clear();
+      const auto results = tailor.search_collapsed(unqualified, 4, 8).expand(unqualified);
+      for (auto i = 0; i < reads.size(); i++) {
+        const auto& aln = results[i].first;
+        CHECK(aln.fallback == tailor.search(reads[i]).first.fallback);
+        CHECK(aln.name == (aln.fallback ? "" : reads[i].name));
+      }
+      CHECK(std::ranges::count_if(results, [](const auto& result) {
+              return result.first.fallback;
+            }) > 0);
+    }
+
+    THEN("Distinct alignments feed miRNA expression with their counts") {
+      auto total = 0.0;
+      for (auto id = 0; id < collapsed.alignments.size(); id++) {
+        const auto& aln = collapsed.alignments[id].first;
+        if (!aln.hits.empty())
+          total += mirna::MirExp::init_from_alignment(aln, collapsed.counts[id]).value;
+      }
+      auto expected = 0.0;
+      for (const auto& read : reads) {
+        const auto aln = tailor.search(read).first;
+        if (!aln.hits.empty())
+          expected += mirna::MirExp::init_from_alignment(aln).value;
+      }
+      CHECK(total == Approx(expected));
+      CHECK(total > 0);
+    }
+  }
+
+  WHEN("The batch is empty") {
+    const auto collapsed = tailor.search_collapsed(std::vector<FastqRecord<>>{}, 4);
+    THEN("Nothing is collapsed") {
+      CHECK(collapsed.alignments.empty());
+      CHECK(collapsed.collapse_ratio() == 1.0);
+    }
+  }
+}
@@ -86,3 +86,72 @@ TEST_CASE("HaplotypeAssembler::assemble - Assembles haplotypes from reads", "[Ha
   REQUIRE(haplotypes[7].score == Approx(-2.33445f));
   REQUIRE(haplotypes[7].cigar == "1024M");
 }
+
+TEST_CASE("HaplotypeAssembler::assemble - Tries kmer sizes concurrently", "[HaplotypeAssembler]") {
+  // Reads joining the halves of the ref back to front close a cycle
+  // through the 25-mers of both, so the graph of 25-mers is dropped.
+  const auto a = std::string{"GATCCTAGCATGCTAGGCTTACGATCGGATC"};
+  const auto b = std::string{"ATTGCAGCTAGCATCGACTAGCATGCAATCG"};
+  const auto c = std::string{"TTCAGGCAATCCGTATGACCTAGGAGTCAACGTTGCAAGT"};
+  const auto ref = a + b + c;
+  auto snp = ref;
+  snp[40] = 'T';
+  auto reads = std::vector<SamRecord<false>>{};
+  for (auto i = 0; i < 2; i++) {
+    reads.push_back(make_sam_record(snp));
+    reads.push_back(make_sam_record(b + a));
+  }
+
+  const auto assembler = HaplotypeAssembler{};
+  const auto haplotypes = assembler.assemble(reads, std::string_view(ref));
+  REQUIRE(haplotypes.size() == 2);
+  for (auto threads : {2, 3, 5, 8}) {
+    const auto concurrent = assembler.assemble(reads, std::string_view(ref), threads);
+    REQUIRE(concurrent.size() == haplotypes.size());
+    for (auto i = 0; i < haplotypes.size(); i++) {
+      CHECK(concurrent[i].seq == haplotypes[i].seq);
+      CHECK(concurrent[i].score == haplotypes[i].score);
+      CHECK(concurrent[i].cigar == haplotypes[i].cigar);
+    }
+  }
+}
+
+TEST_CASE("HaplotypeAssembler::assemble - Reuses a workspace across windows", "[HaplotypeAssembler]") {
+  const auto a = std::string{"GATCCTAGCATGCTAGGCTTACGATCGGATC"};
+  const auto b = std::string{"ATTGCAGCTAGCATCGACTAGCATGCAATCG"};
+  const auto c = std::string{"TTCAGGCAATCCGTATGACCTAGGAGTCAACGTTGCAAGT"};
+  const auto window = [](const std::string& ref, std::size_t snp_pos,
+                         const std::string& loop) {
+    auto snp = ref;
+    snp[snp_pos] = snp[snp_pos] == 'T' ? 'A' : 'T';
+    auto reads = std::vector<SamRecord<false>>{};
+    for (auto i = 0; i < 2; i++) {
+      reads.push_back(make_sam_record(snp));
+      reads.push_back(make_sam_record(loop));
+    }
+    return std::pair{ref, reads};
+  };
+  // The first window only assembles with 35-mers, the second with 25-mers,
+  // whose ref kmers across the N are not packed.
+  const auto windows = std::vector{window(a + b + c, 40, b + a),
+                                   window(a + b + "N" + c, 30, c)};
+
+  const auto assembler = HaplotypeAssembler{};
+  auto workspace = HaplotypeAssembler::Workspace{};
+  auto haplotypes = std::vector<Haplotype>{};
+  for (auto threads : {1, 3}) {
+    for (auto i : {0, 1, 0, 1}) {
+      const auto& [ref, reads] = windows[i];
+      assembler.assemble(reads, std::string_view(ref), workspace, haplotypes, threads);
+      const auto expected = assembler.assemble(reads, std::string_view(ref));
+      REQUIRE(haplotypes.size() == 2);
+      REQUIRE(haplotypes.size() == expected.size());
+      for (auto j = 0; j < expected.size(); j++) {
+        CHECK(haplotypes[j].seq == expected[j].seq);
+        CHECK(haplotypes[j].score == expected[j].score);
+        CHECK(haplotypes[j].cigar == expected[j].cigar);
+        CHECK(haplotypes[j].align_begin_wrt_ref == expected[j].align_begin_wrt_ref);
+      }
+    }
+  }
+}
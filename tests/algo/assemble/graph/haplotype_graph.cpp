@@ -0,0 +1,61 @@
+#include <biovoltron/algo/assemble/graph/haplotype_graph.hpp>
+#include <catch.hpp>
+
+using namespace biovoltron;
+
+TEST_CASE("HaplotypeGraph - Detects cycles and counts unique kmers", "[HaplotypeGraph]") {
+  const auto a = std::string{"GATCCTAGCATGCTAGGCTTACGATCGGATC"};
+  const auto b = std::string{"ATTGCAGCTAGCATCGACTAGCATGCAATCG"};
+  const auto ref = a + b;
+  const auto read = [](const std::string& seq) {
+    auto record = SamRecord<>{};
+    record.seq = seq;
+    record.qual = std::string(seq.size(), 'I');
+    return record;
+  };
+  // Reads joining b back to a close a loop through the kmers of both.
+  const auto reads = std::vector{read(b + a), read(b + a)};
+
+  const auto build = [&](int kmer_size, std::string_view ref) {
+    auto graph = HaplotypeGraph(kmer_size);
+    graph.set_ref(ref);
+    for (const auto& read : reads) graph.set_read(read);
+    graph.build();
+    return graph;
+  };
+
+  SECTION("Kmers shorter than the halves see the loop") {
+    auto graph = build(25, ref);
+    CHECK(graph.has_cycles());
+    CHECK(graph.unique_kmers_count() == 2 * 7 + 2 * 24);
+  }
+
+  SECTION("Kmers longer than the halves do not") {
+    auto graph = build(35, ref);
+    CHECK_FALSE(graph.has_cycles());
+    CHECK(graph.unique_kmers_count() == 2 * 28);
+    const auto haplotypes = graph.find_paths();
+    REQUIRE(haplotypes.size() == 1);
+    CHECK(haplotypes[0].seq == ref);
+    CHECK(haplotypes[0].score == 0);
+  }
+
+  SECTION("Repeated kmers get a vertex per occurrence") {
+    const auto repeated = ref + ref;
+    auto graph = build(35, repeated);
+    CHECK_FALSE(graph.has_cycles());
+    // Only the kmers across the copies are unique, the reads' among them.
+    CHECK(graph.unique_kmers_count() == 34);
+    CHECK(graph.find_paths().front().seq == repeated);
+  }
+
+  SECTION("Kmers with other bases than ACGT stay apart") {
+    auto masked = ref;
+    masked[30] = 'N';
+    masked[31] = 'a';
+    CHECK(build(25, masked).has_cycles());
+    auto graph = build(35, masked);
+    CHECK_FALSE(graph.has_cycles());
+    CHECK(graph.find_paths().front().seq == masked);
+  }
+}
@@ -1,5 +1,7 @@
 #include <biovoltron/applications/burrow_wheeler_aligner/burrow_wheeler_aligner.hpp>
 #include <iostream> //debug
+#include <map>
+#include <random>
 #include <catch.hpp>
 
 using namespace biovoltron;
@@ -228,8 +230,327 @@ TEST_CASE("BurrowWheelerAligner::generate_sam - Generates SAM records", "[Burrow
     //           << duration_cast<milliseconds>(t1 - t_start).count()
     //           << " ms\n";
   }
+
+  SECTION("Profile counts stages and merges across threads")
+  {
+    BurrowWheelerAligner aligner{ref, index};
+
+    auto profile1 = BurrowWheelerAligner::Profile{};
+    auto profile2 = BurrowWheelerAligner::Profile{};
+    const auto [rec1, rec2]
+      = aligner.generate_sam({read1_ori, read2_ori}, profile1);
+    CHECK(rec1.flag == 99);
+    CHECK(rec2.flag == 147);
+    CHECK(profile1.read_cnt == 2);
+    CHECK(profile1.seed_cnt > 0);
+    CHECK(profile1.anchor_cnt >= profile1.seed_cnt);
+    CHECK(profile1.exact_match_cnt >= 2);
+
+    const auto read = FastqRecord<true>{
+      {"read1/1", Codec::to_istring("AAGGTTAAGGTTAAGGTTAAGGTTAAGGTAAAAA")},
+      "IIIIIIIIIIIIIIIIIIIIIIIIIIIIIIII"
+    };
+    aligner.generate_sam({read, read}, profile2);
+
+    auto total = BurrowWheelerAligner::Profile{};
+    total += profile1;
+    total += profile2;
+    CHECK(total.read_cnt == 4);
+    CHECK(total.sw_cnt == profile1.sw_cnt + profile2.sw_cnt);
+    CHECK(total.elapsed[BurrowWheelerAligner::Profile::SEEDING]
+          == profile1.elapsed[BurrowWheelerAligner::Profile::SEEDING]
+           + profile2.elapsed[BurrowWheelerAligner::Profile::SEEDING]);
+
+    auto json = std::ostringstream{};
+    total.to_json(json);
+    CHECK(json.str().starts_with("{\"reads\": 4, \"counters\": {\"seeds\": "));
+    CHECK(json.str().find("\"elapsed_ms\": {\"seeding\": ") != std::string::npos);
+    CHECK(json.str().ends_with("}}"));
+  }
+}
+
+TEST_CASE("BurrowWheelerAligner::generate_sam - Multi-contig reference", "[BurrowWheelerAligner]")
+{
+  auto engine = std::mt19937{7};
+  auto dist = std::uniform_int_distribution<int>{0, 3};
+  const auto random_seq = [&](auto size) {
+    auto seq = istring{};
+    for (auto i = 0; i < size; i++) seq += static_cast<ichar>(dist(engine));
+    return seq;
+  };
+
+  // Note: like hs37d5, the reference needs a masked head so that rescue
+  // windows (PAIR_DIST upstream) stay in bounds.
+  const auto [ref, chr_bounds] = BurrowWheelerAligner::concat_ref({
+    {"chrA", istring(1500, 0) + random_seq(400)},
+    {"chrB", random_seq(500)},
+    {"chrC", random_seq(300)}});
+  REQUIRE(ref.seq.size() == 2700);
+  REQUIRE(chr_bounds.size() == 3);
+  CHECK(chr_bounds[1].last_elem_pos == 2399);
+
+  auto index = FMIndex<1, uint32_t, StableSorter<uint32_t>>{.LOOKUP_LEN = 8};
+  index.build(ref.seq);
+  const auto aligner = BurrowWheelerAligner{ref, index, {}, chr_bounds};
+
+  SECTION("Global positions are translated to contig positions")
+  {
+    CHECK(aligner.get_chr_idx(0) == 0);
+    CHECK(aligner.get_chr_idx(1899) == 0);
+    CHECK(aligner.get_chr_idx(1900) == 1);
+    CHECK(aligner.get_chr_idx(2699) == 2);
+    CHECK(aligner.get_chr_idx(2700) == 3);
+    CHECK(aligner.get_chr_pos(1950) == std::pair<std::string_view, std::uint32_t>{"chrB", 50});
+    CHECK(aligner.crosses_bound(1880, 40));
+    CHECK(!aligner.crosses_bound(1900, 40));
+  }
+
+  SECTION("Pair is reported on its own contig")
+  {
+    const auto seq = istring_view{ref.seq};
+    const auto read1 = FastqRecord<true>{
+      {"pair/1", istring{seq.substr(2000, 50)}}, std::string(50, 'I')};
+    const auto read2 = FastqRecord<true>{
+      {"pair/2", Codec::rev_comp(seq.substr(2200, 50))}, std::string(50, 'I')};
+
+    const auto [rec1, rec2] = aligner.generate_sam({read1, read2});
+    CHECK(rec1.rname == "chrB");
+    CHECK(rec1.pos == 101);
+    CHECK(rec1.rnext == "=");
+    CHECK(rec1.pnext == 301);
+    CHECK(rec2.rname == "chrB");
+    CHECK(rec2.pos == 301);
+    CHECK(rec1.flag == 99);
+    CHECK(rec2.flag == 147);
+  }
+
+  SECTION("Alignments spanning two contigs are dropped")
+  {
+    const auto seq = istring_view{ref.seq};
+    const auto read1 = FastqRecord<true>{
+      {"span/1", istring{seq.substr(2375, 50)}}, std::string(50, 'I')};
+    const auto read2 = FastqRecord<true>{
+      {"span/2", Codec::rev_comp(seq.substr(2500, 50))}, std::string(50, 'I')};
+
+    const auto [rec1, rec2] = aligner.generate_sam({read1, read2});
+    CHECK(rec2.rname == "chrC");
+    CHECK(rec2.pos == 101);
+    CHECK(rec1.cigar == "*");
+    CHECK(rec1.rname == "*");
+    CHECK(rec1.pos == 0);
+    CHECK(rec2.pnext == 0);
+    CHECK(rec1.flag & 0x4);
+    CHECK(rec2.flag & 0x8);
+  }
+
+  SECTION("BAM records carry the same fields as SAM records")
+  {
+    const auto seq = istring_view{ref.seq};
+    const auto read1 = FastqRecord<true>{
+      {"pair/1 extra", istring{seq.substr(2000, 50)}}, std::string(25, 'I') + std::string(25, '#')};
+    const auto read2 = FastqRecord<true>{
+      {"pair/2 extra", Codec::rev_comp(seq.substr(2200, 50))}, std::string(25, 'I') + std::string(25, '#')};
+
+    const auto [sam1, sam2] = aligner.generate_sam({read1, read2});
+    auto records = std::pair<BamRecord, BamRecord>{};
+    aligner.generate_bam({read1, read2}, records);
+    for (const auto& [sam, bam] : {std::pair{sam1, records.first}, std::pair{sam2, records.second}}) {
+      CHECK(bam.get_qname() == sam.qname);
+      CHECK(bam.flag == sam.flag);
+      CHECK(bam.tid == 1);
+      CHECK(bam.pos + 1 == sam.pos);
+      CHECK(bam.mapq == sam.mapq);
+      CHECK(bam.get_cigar() == sam.cigar);
+      CHECK(bam.mtid == 1);
+      CHECK(bam.mpos + 1 == sam.pnext);
+      CHECK(bam.isize == sam.tlen);
+      CHECK(bam.get_seq() == sam.seq);
+      CHECK(bam.get_qual() == sam.qual);
+    }
+
+    const auto span = FastqRecord<true>{
+      {"span/1", istring{seq.substr(2375, 50)}}, std::string(50, 'I')};
+    aligner.generate_bam({span, read2}, records);
+    CHECK(records.first.tid == -1);
+    CHECK(records.first.pos == -1);
+    CHECK(records.first.n_cigar == 0);
+    CHECK(records.first.flag & 0x4);
+    CHECK(records.second.mtid == -1);
+    CHECK(records.second.mpos == -1);
+
+    auto record = BamRecord{};
+    aligner.generate_bam(read2, record);
+    CHECK(record.tid == 1);
+    CHECK(record.pos == 300);
+    CHECK(record.flag == 16);
+    CHECK(record.mtid == -1);
+    CHECK(record.mpos == -1);
+  }
 }
 
+TEST_CASE("BurrowWheelerAligner - Single-end mode and insert size estimation", "[BurrowWheelerAligner]")
+{
+  auto engine = std::mt19937{11};
+  auto base = std::uniform_int_distribution<int>{0, 3};
+  auto seq = istring(1500, 0);
+  for (auto i = 0; i < 4000; i++) seq += static_cast<ichar>(base(engine));
+  const auto ref = FastaRecord<true>{"chrT", seq};
+
+  auto index = FMIndex<1, uint32_t, StableSorter<uint32_t>>{.LOOKUP_LEN = 8};
+  index.build(ref.seq);
+  const auto aligner = BurrowWheelerAligner{ref, index};
+
+  SECTION("Single-end read skips pairing and rescue")
+  {
+    const auto read = FastqRecord<true>{
+      {"se/1 comment", Codec::rev_comp(istring_view{ref.seq}.substr(2500, 60))},
+      std::string(60, 'I')};
+
+    auto profile = BurrowWheelerAligner::Profile{};
+    const auto rec = aligner.generate_sam(read, profile);
+    CHECK(rec.qname == "se/1");
+    CHECK(rec.flag == 16);
+    CHECK(rec.rname == "chrT");
+    CHECK(rec.pos == 2501);
+    CHECK(rec.cigar == "60M");
+    CHECK(rec.rnext == "*");
+    CHECK(profile.read_cnt == 1);
+    CHECK(profile.rescue_cnt == 0);
+    CHECK(profile.elapsed[BurrowWheelerAligner::Profile::RESCUE].count() == 0);
+    CHECK(profile.elapsed[BurrowWheelerAligner::Profile::PAIRING].count() == 0);
+
+    const auto unmapped = FastqRecord<true>{
+      {"se/2", Codec::to_istring(std::string(60, 'G'))}, std::string(60, 'I')};
+    const auto rec2 = aligner.generate_sam(unmapped);
+    CHECK(rec2.flag == 4);
+    CHECK(rec2.cigar == "*");
+    CHECK(rec2.rname == "*");
+  }
+
+  SECTION("Insert size is estimated from confidently paired reads")
+  {
+    auto insert_dist = std::normal_distribution<double>{300, 20};
+    auto start_dist = std::uniform_int_distribution<int>{1600, 5000};
+    auto reads = std::vector<std::pair<FastqRecord<>, FastqRecord<>>>{};
+    for (auto i = 0; i < 64; i++) {
+      const auto insert = static_cast<int>(insert_dist(engine));
+      const auto start = start_dist(engine);
+      const auto view = istring_view{ref.seq};
+      reads.emplace_back(
+        FastqRecord<true>{{"pair", istring{view.substr(start, 50)}}, std::string(50, 'I')},
+        FastqRecord<true>{{"pair", Codec::rev_comp(view.substr(start + insert - 50, 50))},
+                          std::string(50, 'I')});
+    }
 
+    auto insert = aligner.default_insert_size();
+    auto profile = BurrowWheelerAligner::Profile{};
+    const auto records = aligner.generate_sam_batch(reads, insert, profile);
+    REQUIRE(records.size() == reads.size());
+    CHECK(records.front().first.qname == "pair");
+    CHECK(insert.mean > 280);
+    CHECK(insert.mean < 320);
+    CHECK(insert.dev > 10);
+    CHECK(insert.dev < 30);
+    CHECK(insert.pair_dist == insert.mean + 4 * insert.dev + 50);
+    CHECK(insert.pair_dist < aligner.args.PAIR_DIST);
+
+    CHECK(!aligner.estimate_insert_size(std::vector<int>(8, 300)));
+  }
+}
 
+namespace {
+
+using Anchor = BurrowWheelerAligner::Anchor;
+
+// The std::map chaining chain_anchors replaced, kept as the reference.
+auto
+map_chain_anchors(const std::vector<Anchor>& anchors, std::uint32_t seed_len) {
+  auto chain_map = std::map<std::uint32_t, std::vector<Anchor>>{};
+  for (const auto anchor : anchors) {
+    const auto read_pos = anchor.ref_pos - anchor.seed_pos;
+    const auto lower = chain_map.lower_bound(read_pos - seed_len);
+    const auto upper = chain_map.upper_bound(read_pos + seed_len);
+    if (lower != upper) {
+      for (auto it = lower; it != upper; ++it) it->second.push_back(anchor);
+      continue;
+    }
+    chain_map[read_pos].push_back(anchor);
+  }
+  auto chains = std::vector<std::vector<Anchor>>{};
+  for (auto& chain : chain_map | std::views::values) {
+    std::ranges::sort(chain);
+    chains.push_back(std::move(chain));
+  }
+  return chains;
+}
 
+// Anchors of a 150bp read whose seeds hit a tandem repeat: every seed has
+// up to MAX_HIT_CNT hits on jittered copies, so diagonals overlap heavily.
+auto
+repeat_anchors(std::mt19937& engine, int hit_cnt) {
+  auto jitter = std::uniform_int_distribution<std::uint32_t>{0, 30};
+  auto anchors = std::vector<Anchor>{};
+  for (auto seed_pos = 0; seed_pos < 150; seed_pos += 12) {
+    for (auto i = 0; i < hit_cnt; i++)
+      anchors.emplace_back(100000 + i * 97 + seed_pos + jitter(engine),
+                           seed_pos, 19, true);
+  }
+  return anchors;
+}
+
+}  // namespace
+
+TEST_CASE("BurrowWheelerAligner::chain_anchors - Matches std::map chaining", "[BurrowWheelerAligner]")
+{
+  const auto aligner = BurrowWheelerAligner{{}, {}, {}};
+  auto engine = std::mt19937{13};
+
+  SECTION("Repeat-heavy anchors")
+  {
+    for (const auto hit_cnt : {1, 8, 64, 512}) {
+      const auto anchors = repeat_anchors(engine, hit_cnt);
+      CHECK(aligner.chain_anchors(anchors)
+            == map_chain_anchors(anchors, aligner.args.SEED_LEN));
+    }
+  }
+
+  SECTION("Arrival order decides the chain keys")
+  {
+    // 15 joins the chains keyed 0 and 30 only if it comes last.
+    const auto anchors = std::vector<Anchor>{
+      {1000, 0, 19, true}, {1030, 0, 19, true}, {1015, 0, 19, true}};
+    const auto chains = aligner.chain_anchors(anchors);
+    REQUIRE(chains.size() == 2);
+    CHECK(chains[0].size() == 2);
+    CHECK(chains[1].size() == 2);
+    CHECK(chains == map_chain_anchors(anchors, aligner.args.SEED_LEN));
+  }
+
+  SECTION("No anchors")
+  {
+    CHECK(aligner.chain_anchors({}).empty());
+  }
+}
+
+TEST_CASE("BurrowWheelerAligner::chain_anchors - Benchmark", "[.][benchmark]")
+{
+  const auto aligner = BurrowWheelerAligner{{}, {}, {}};
+  auto engine = std::mt19937{17};
+  const auto anchors = repeat_anchors(engine, aligner.args.MAX_HIT_CNT);
+  constexpr auto rounds = 200;
+
+  auto chain_cnt = std::size_t{};
+  auto start = high_resolution_clock::now();
+  for (auto i = 0; i < rounds; i++)
+    chain_cnt += map_chain_anchors(anchors, aligner.args.SEED_LEN).size();
+  const auto map_time = duration_cast<microseconds>(high_resolution_clock::now() - start);
+
+  start = high_resolution_clock::now();
+  for (auto i = 0; i < rounds; i++)
+    chain_cnt -= aligner.chain_anchors(anchors).size();
+  const auto flat_time = duration_cast<microseconds>(high_resolution_clock::now() - start);
+
+  std::cout << anchors.size() << " anchors, " << rounds << " rounds: std::map "
+            << map_time.count() << " us, flat " << flat_time.count() << " us\n";
+  CHECK(chain_cnt == 0);
+}
@@ -1,6 +1,35 @@
 #include <biovoltron/applications/haplotypecaller/haplotypecaller.hpp>
 #include <iostream> //debug
 #include <catch.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+// Allocations made by the test executable, for the benchmark below.
+auto alloc_cnt = std::atomic<std::size_t>{};
+
+}  // namespace
+
+void*
+operator new(std::size_t size) {
+  alloc_cnt.fetch_add(1, std::memory_order_relaxed);
+  if (auto ptr = std::malloc(size == 0 ? 1 : size))
+    return ptr;
+  throw std::bad_alloc{};
+}
+
+void
+operator delete(void* ptr) noexcept {
+  std::free(ptr);
+}
+
+void
+operator delete(void* ptr, std::size_t) noexcept {
+  std::free(ptr);
+}
 
 using namespace biovoltron;
 
@@ -266,3 +295,265 @@ TEST_CASE("HaplotypeCaller::call_region - Calls haplotypes", "[HaplotypeCaller]"
   // REQUIRE(variants[2].gt == std::make_pair<std::uint16_t, std::uint16_t>(1, 1));
   */
 }
+
+namespace {
+
+// Reads tiling two haplotypes of a random reference, with SNPs every 450
+// bases alternating hom-alt and het. A few low quality sequencing errors per
+// read keep the reads from being modeled perfectly.
+auto
+diploid_sample(std::size_t len) {
+  auto x = 12345u;
+  auto rand = [&] { x = x * 1103515245 + 12345; return (x >> 16) & 0x7fff; };
+  const auto bases = std::string{"ACGT"};
+  const auto other_base = [&](char c, int shift) {
+    return bases[(bases.find(c) + shift) % 4];
+  };
+
+  auto ref = std::string{};
+  for (auto i = 0; i < len; i++) ref += bases[rand() % 4];
+  auto haps = std::array{ref, ref};
+  auto snps = std::vector<std::uint32_t>{};
+  for (auto pos = 300; pos + 300 < len; pos += 450) {
+    haps[0][pos] = other_base(ref[pos], 1);
+    if (snps.size() % 2 == 0) haps[1][pos] = haps[0][pos];
+    snps.push_back(pos);
+  }
+
+  auto sam = std::vector<SamRecord<>>{};
+  for (auto begin = 0; begin + 100 <= len; begin += 3) {
+    for (auto h = 0; h < 2; h++) {
+      auto record = SamRecord<>{};
+      record.qname = "read" + std::to_string(sam.size());
+      record.rname = "chr1";
+      record.pos = begin + 1;
+      record.mapq = 60;
+      record.cigar = Cigar{"100M"};
+      record.rnext = "=";
+      record.seq = haps[h].substr(begin, 100);
+      record.qual = std::string(100, 'I');
+      for (auto e = 0; e < 3; e++) {
+        const auto i = rand() % 100;
+        record.seq[i] = other_base(record.seq[i], 1 + rand() % 3);
+        record.qual[i] = '*';
+      }
+      sam.push_back(record);
+    }
+  }
+  return std::tuple{FastaRecord<>{"chr1", ref}, sam, snps};
+}
+
+auto
+to_strings(const std::vector<VcfRecord>& records) {
+  auto strs = std::vector<std::string>{};
+  for (const auto& record : records) {
+    auto ss = std::ostringstream{};
+    ss << record;
+    strs.push_back(ss.str());
+  }
+  return strs;
+}
+
+}  // namespace
+
+TEST_CASE("HaplotypeCaller::run - Calls windows in parallel", "[HaplotypeCaller]") {
+  const auto [ref, sam, snps] = diploid_sample(2000);
+  const auto haplotype_caller = HaplotypeCaller{.ref = ref};
+
+  const auto variants = haplotype_caller.run(sam, 1);
+  REQUIRE(variants.size() == snps.size());
+  for (auto i = 0; i < snps.size(); i++) {
+    CHECK(variants[i].pos == snps[i] + 1);
+    CHECK(variants[i].ref == ref.seq.substr(snps[i], 1));
+  }
+
+  SECTION("Variants are merged in coordinate order") {
+    CHECK(to_strings(haplotype_caller.run(sam, 4)) == to_strings(variants));
+    CHECK(to_strings(haplotype_caller.run(sam, 64)) == to_strings(variants));
+  }
+
+  SECTION("Skipping inactive windows keeps the calls") {
+    auto stats = HaplotypeCaller::RunStats{};
+    CHECK(to_strings(haplotype_caller.run(sam, 4, &stats)) == to_strings(variants));
+    CHECK(stats.skipped_cnt > 0);
+    CHECK(stats.skipped_cnt < stats.window_cnt);
+
+    const auto assemble_all = HaplotypeCaller{
+      .ref = ref, .args = {.ACTIVE_PROB_THRESHOLD = 0}};
+    CHECK(to_strings(assemble_all.run(sam, 4, &stats)) == to_strings(variants));
+    CHECK(stats.skipped_cnt == 0);
+  }
+
+  SECTION("Input need not be sorted by coordinate") {
+    auto unsorted = sam;
+    std::ranges::stable_sort(unsorted, std::greater{}, &SamRecord<>::pos);
+    CHECK(to_strings(haplotype_caller.run(unsorted)) == to_strings(variants));
+  }
+
+  SECTION("Reads are streamed from an indexed BAM file") {
+    const auto bam_path = std::filesystem::temp_directory_path() / "haplotypecaller.bam";
+    {
+      auto header = SamHeader{};
+      header.lines = {"@HD\tVN:1.6\tSO:coordinate",
+                      "@SQ\tSN:chr1\tLN:" + std::to_string(ref.seq.size())};
+      auto fout = OBamStream{bam_path, true};
+      fout << header;
+      for (auto record : sam) fout << record;
+    }
+    auto fin = IBamStream{bam_path};
+    auto streamed = std::vector<VcfRecord>{};
+    const auto small_batches = HaplotypeCaller{
+      .ref = ref, .args = {.STREAM_BATCH_WINDOWS = 3}};
+    const auto variant_cnt = small_batches.run(
+      fin, [&](VcfRecord record) { streamed.push_back(std::move(record)); }, 4);
+    CHECK(variant_cnt == variants.size());
+    CHECK(to_strings(streamed) == to_strings(variants));
+    std::filesystem::remove(bam_path);
+    std::filesystem::remove(bam_path.string() + ".bai");
+  }
+}
+
+TEST_CASE("HaplotypeCaller::run - Emits GVCF blocks between the variants", "[HaplotypeCaller]") {
+  const auto [ref, sam, snps] = diploid_sample(2000);
+  const auto variants = HaplotypeCaller{.ref = ref}.run(sam, 1);
+  const auto gvcf_caller = HaplotypeCaller{.ref = ref, .args = {.GVCF = true}};
+  const auto records = gvcf_caller.run(sam, 4);
+
+  auto calls = std::vector<VcfRecord>{};
+  auto block_cnt = 0;
+  auto next_pos = std::uint32_t{1};
+  for (const auto& record : records) {
+    // Blocks and variants tile the reference.
+    REQUIRE(record.pos == next_pos);
+    if (record.alt != "<NON_REF>") {
+      // Variants carry <NON_REF> and the PLs of its genotypes.
+      REQUIRE(record.alt.ends_with(",<NON_REF>"));
+      const auto allele_cnt = std::ranges::count(record.alt, ',') + 2;
+      const auto& sample = record.samples.front();
+      CHECK(std::ranges::count(sample, ',') + 1
+            == allele_cnt * (allele_cnt + 1) / 2);
+      // GT is the genotype of the lowest PL and GQ the second lowest.
+      auto fields = std::istringstream{sample};
+      auto gt = std::string{}, gq = std::string{}, pl = std::string{};
+      std::getline(fields, gt, ':');
+      std::getline(fields, gq, ':');
+      auto pls = std::vector<int>{};
+      while (std::getline(fields, pl, ','))
+        pls.push_back(std::stoi(pl));
+      const auto a1 = std::stoi(gt.substr(0, 1)), a2 = std::stoi(gt.substr(2));
+      CHECK(pls[a2 * (a2 + 1) / 2 + a1] == 0);
+      std::ranges::sort(pls);
+      CHECK(std::stoi(gq) == pls[1]);
+      calls.push_back(record);
+      calls.back().alt.resize(record.alt.size() - 10);
+      next_pos += record.ref.size();
+      continue;
+    }
+    block_cnt++;
+    CHECK(record.ref == ref.seq.substr(record.pos - 1, 1));
+    CHECK(record.info.starts_with("END="));
+    next_pos = std::stoul(record.info.substr(4)) + 1;
+    CHECK(next_pos > record.pos);
+  }
+  CHECK(next_pos == ref.seq.size() + 1);
+  REQUIRE(calls.size() == variants.size());
+  for (auto i = 0; i < calls.size(); i++) {
+    CHECK(calls[i].pos == variants[i].pos);
+    CHECK(calls[i].ref == variants[i].ref);
+    CHECK(calls[i].alt == variants[i].alt);
+    CHECK(calls[i].samples.front().substr(0, 3)
+          == variants[i].samples.front().substr(0, 3));
+  }
+  // Far fewer blocks than bases.
+  CHECK(block_cnt < ref.seq.size() / 10);
+
+  SECTION("The header declares the GVCF fields") {
+    const auto& lines = gvcf_caller.vcf_header().lines;
+    CHECK(lines.front() == "##fileformat=VCFv4.2");
+    for (const auto id : {"##ALT=<ID=NON_REF,", "##INFO=<ID=END,",
+                          "##FORMAT=<ID=MIN_DP,", "##GVCFBlock60-100="})
+      CHECK(std::ranges::count_if(lines, [=](const auto& line) {
+              return line.starts_with(id);
+            }) == 1);
+    CHECK(lines.back().starts_with("#CHROM\tPOS"));
+    CHECK(std::ranges::none_of(
+      HaplotypeCaller{.ref = ref}.vcf_header().lines,
+      [](const auto& line) { return line.starts_with("##ALT"); }));
+  }
+
+  SECTION("Blocks are streamed along with the variants") {
+    const auto bam_path = std::filesystem::temp_directory_path() / "haplotypecaller_gvcf.bam";
+    {
+      auto header = SamHeader{};
+      header.lines = {"@HD\tVN:1.6\tSO:coordinate",
+                      "@SQ\tSN:chr1\tLN:" + std::to_string(ref.seq.size())};
+      auto fout = OBamStream{bam_path, true};
+      fout << header;
+      for (auto record : sam) fout << record;
+    }
+    auto fin = IBamStream{bam_path};
+    auto streamed = std::vector<VcfRecord>{};
+    const auto small_batches = HaplotypeCaller{
+      .ref = ref, .args = {.STREAM_BATCH_WINDOWS = 3, .GVCF = true}};
+    const auto record_cnt = small_batches.run(
+      fin, [&](VcfRecord record) { streamed.push_back(std::move(record)); }, 4);
+    CHECK(record_cnt == records.size());
+    CHECK(to_strings(streamed) == to_strings(records));
+    std::filesystem::remove(bam_path);
+    std::filesystem::remove(bam_path.string() + ".bai");
+  }
+}
+
+TEST_CASE("HaplotypeCaller::run - Downsamples deep begins reproducibly", "[HaplotypeCaller]") {
+  const auto [ref, sam, snps] = diploid_sample(2000);
+  // Four distinct reads per haplotype at each begin, twice the cap.
+  auto deep = std::vector<SamRecord<>>{};
+  for (const auto& record : sam) {
+    deep.push_back(record);
+    for (auto copy = 1; copy < 4; copy++) {
+      auto read = record;
+      read.qname += "_" + std::to_string(copy);
+      const auto i = copy * 31 % read.seq.size();
+      read.seq[i] = read.seq[i] == 'A' ? 'C' : 'A';
+      read.qual[i] = '*';
+      deep.push_back(std::move(read));
+    }
+  }
+
+  const auto haplotype_caller = HaplotypeCaller{.ref = ref};
+  const auto variants = haplotype_caller.run(deep, 1);
+  REQUIRE(variants.size() == snps.size());
+  CHECK(to_strings(haplotype_caller.run(deep, 1)) == to_strings(variants));
+  CHECK(to_strings(haplotype_caller.run(deep, 4)) == to_strings(variants));
+
+  const auto reseeded = HaplotypeCaller{
+    .ref = ref, .args = {.DOWNSAMPLE_SEED = 42}};
+  CHECK(to_strings(reseeded.run(deep, 4)) == to_strings(reseeded.run(deep, 1)));
+}
+
+TEST_CASE("HaplotypeCaller::run - Benchmark", "[.][benchmark]") {
+  const auto [ref, sam, snps] = diploid_sample(60000);
+  auto variants = std::vector<std::string>{};
+  for (const auto threads : {1u, 4u}) {
+    for (const auto batch_windows : {1u, 4u, 64u}) {
+      const auto haplotype_caller = HaplotypeCaller{
+        .ref = ref, .args = {.STREAM_BATCH_WINDOWS = batch_windows}};
+      auto stats = HaplotypeCaller::RunStats{};
+      const auto alloc_start = alloc_cnt.load();
+      const auto start = std::chrono::steady_clock::now();
+      const auto calls = to_strings(haplotype_caller.run(sam, threads, &stats));
+      const auto time = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start);
+      const auto active_cnt = stats.window_cnt - stats.skipped_cnt;
+
+      std::cout << threads << " threads, " << batch_windows
+                << " windows per batch: " << time.count() << " ms, "
+                << static_cast<double>(alloc_cnt - alloc_start) / active_cnt
+                << " allocations per active window\n";
+      if (variants.empty())
+        variants = calls;
+      CHECK(calls == variants);
+    }
+  }
+  CHECK(variants.size() == snps.size());
+}
@@ -0,0 +1,62 @@
+#include <biovoltron/applications/haplotypecaller/activity_profile.hpp>
+#include <catch.hpp>
+
+using namespace biovoltron;
+
+TEST_CASE("ActivityProfile::compute - Scores non-reference evidence per base", "[ActivityProfile]") {
+  const auto ref = std::string{
+    "GATCCTAGCATGCTAGGCTTACGATCGGATCATTGCAGCTAGCATCGACTAGCATGCAATCGGCTA"};
+  const auto ref_region = Interval{"chr1", 1000, 1000 + std::uint32_t(ref.size())};
+  const auto region = Interval{"chr1", 1010, 1050};
+
+  const auto make_reads = [&](std::string_view cigar, auto edit) {
+    auto reads = std::vector<SamRecord<>>{};
+    for (auto i = 0; i < 20; i++) {
+      auto read = SamRecord<>{};
+      read.pos = ref_region.begin + 6;
+      read.cigar = Cigar{cigar};
+      read.seq = ref.substr(5, 50);
+      edit(read.seq);
+      read.qual = std::string(read.seq.size(), 'I');
+      reads.push_back(read);
+    }
+    return reads;
+  };
+  const auto active_sites = [&](const auto& reads) {
+    const auto activity = ActivityProfile::compute(reads, ref, ref_region, region);
+    REQUIRE(activity.size() == region.size());
+    auto sites = std::vector<std::uint32_t>{};
+    for (auto i = 0u; i < activity.size(); i++)
+      if (activity[i] >= 0.002) sites.push_back(region.begin + i);
+    return sites;
+  };
+
+  SECTION("Reference-like reads are not active") {
+    const auto reads = make_reads("50M", [](auto&) {});
+    CHECK(active_sites(reads).empty());
+    CHECK_FALSE(ActivityProfile::is_active(reads, ref, ref_region, region, 0.002));
+  }
+
+  SECTION("Mismatches make their site active") {
+    auto reads = make_reads("50M", [](auto& seq) { seq[20] = seq[20] == 'A' ? 'C' : 'A'; });
+    CHECK(active_sites(reads) == std::vector<std::uint32_t>{1025});
+    CHECK(ActivityProfile::is_active(reads, ref, ref_region, region, 0.002));
+
+    // Low quality mismatches are ignored.
+    for (auto& read : reads) read.qual[20] = '#';
+    CHECK(active_sites(reads).empty());
+  }
+
+  SECTION("Indels and soft clips make their site active") {
+    CHECK(active_sites(make_reads("20M1I29M", [](auto& seq) { seq.insert(20, "T"); seq.pop_back(); }))
+          == std::vector<std::uint32_t>{1025});
+    CHECK(active_sites(make_reads("20M2D30M", [](auto& seq) { seq.erase(20, 2); seq += "AA"; }))
+          == std::vector<std::uint32_t>{1025, 1026});
+    CHECK(active_sites(make_reads("40M10S", [](auto&) {}))
+          == std::vector<std::uint32_t>{1044});
+    // The clip lies left of the region.
+    CHECK(active_sites(make_reads("10S40M", [](auto& seq) {
+      seq = std::string(10, 'N') + seq.substr(0, 40);
+    })).empty());
+  }
+}
@@ -0,0 +1,53 @@
+#include <biovoltron/applications/haplotypecaller/genotype/reference_confidence_model/gvcf_block_combiner.hpp>
+#include <catch.hpp>
+
+using namespace biovoltron;
+
+TEST_CASE("GvcfBlockCombiner - Merges bases by GQ band", "[GvcfBlockCombiner]") {
+  auto records = std::vector<VcfRecord>{};
+  const auto output = [&](VcfRecord record) { records.push_back(std::move(record)); };
+  const auto confidence = [](int gq, std::uint32_t depth) {
+    return ReferenceConfidenceModel::RefConfidence{{0, gq, gq * 10}, gq, depth};
+  };
+  auto blocks = GvcfBlockCombiner{{5, 20, 60}};
+
+  blocks.add("chr1", 10, 'A', confidence(30, 12), output);
+  blocks.add("chr1", 11, 'C', confidence(25, 9), output);
+  blocks.add("chr1", 12, 'G', confidence(50, 20), output);
+  CHECK(records.empty());
+
+  // Another band closes the block.
+  blocks.add("chr1", 13, 'T', confidence(3, 1), output);
+  REQUIRE(records.size() == 1);
+  CHECK(records[0].pos == 11);
+  CHECK(records[0].ref == "A");
+  CHECK(records[0].alt == "<NON_REF>");
+  CHECK(records[0].info == "END=13");
+  CHECK(records[0].samples == std::vector<std::string>{"0/0:25:9:0,25,250"});
+
+  // So do a variant, and a gap.
+  blocks.cover(Interval{"chr1", 14, 17}, output);
+  REQUIRE(records.size() == 2);
+  CHECK(records[1].info == "END=14");
+  blocks.add("chr1", 15, 'A', confidence(3, 1), output);
+  blocks.add("chr1", 16, 'A', confidence(3, 1), output);
+  blocks.add("chr1", 17, 'A', confidence(3, 1), output);
+  blocks.add("chr1", 19, 'A', confidence(3, 1), output);
+  blocks.flush(output);
+  REQUIRE(records.size() == 4);
+  CHECK(records[2].pos == 18);
+  CHECK(records[2].info == "END=18");
+  CHECK(records[3].pos == 20);
+  CHECK(records[3].info == "END=20");
+}
+
+TEST_CASE("GvcfBlockCombiner - Declares its header lines", "[GvcfBlockCombiner]") {
+  const auto lines = GvcfBlockCombiner{{20, 60}}.header_lines();
+  REQUIRE(lines.size() == 6);
+  CHECK(lines[0].starts_with("##ALT=<ID=NON_REF,"));
+  CHECK(lines[1].starts_with("##INFO=<ID=END,"));
+  CHECK(lines[2].starts_with("##FORMAT=<ID=MIN_DP,"));
+  CHECK(lines[3] == "##GVCFBlock0-20=minGQ=0(inclusive),maxGQ=20(exclusive)");
+  CHECK(lines[4] == "##GVCFBlock20-60=minGQ=20(inclusive),maxGQ=60(exclusive)");
+  CHECK(lines[5] == "##GVCFBlock60-100=minGQ=60(inclusive),maxGQ=100(exclusive)");
+}
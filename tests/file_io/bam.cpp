@@ -103,4 +103,58 @@ TEST_CASE("OBamStream::IO - Writes BAM files", "[BamStream]") {
     foo(false);
     foo(true);
   }
+  SECTION("Packed BamRecord output") {
+    SamHeader h1;
+    SamRecord<false> s1, s2;
+    {
+      IBamStream fin(in);
+      fin >> h1;
+      fin >> s1;
+    }
+    auto tid = 0;
+    for (const auto& line : h1.lines) {
+      if (!line.starts_with("@SQ"))
+        continue;
+      if (line.find("\tSN:" + s1.rname + "\t") != std::string::npos)
+        break;
+      tid++;
+    }
+    auto record = BamRecord{};
+    record.tid = tid;
+    record.pos = s1.pos - 1;
+    record.mapq = s1.mapq;
+    record.flag = s1.flag;
+    record.mtid = tid;
+    record.mpos = s1.pnext - 1;
+    record.isize = s1.tlen;
+    record.append_qname(s1.qname);
+    record.append_cigar(s1.cigar);
+    record.append_seq(std::string_view{s1.seq});
+    record.append_qual(s1.qual);
+    record.append_aux("NH", 1);
+    {
+      OBamStream fout(out);
+      fout << h1;
+      fout << record;
+      fout << record;
+    }
+    {
+      IBamStream fin(out);
+      SamHeader h2;
+      fin >> h2;
+      fin >> s2;
+    }
+    REQUIRE(s2.qname == s1.qname);
+    REQUIRE(s2.flag == s1.flag);
+    REQUIRE(s2.rname == s1.rname);
+    REQUIRE(s2.pos == s1.pos);
+    REQUIRE(s2.mapq == s1.mapq);
+    REQUIRE(s2.cigar == s1.cigar);
+    REQUIRE(s2.rnext == s1.rnext);
+    REQUIRE(s2.pnext == s1.pnext);
+    REQUIRE(s2.tlen == s1.tlen);
+    REQUIRE(s2.seq == s1.seq);
+    REQUIRE(s2.qual == s1.qual);
+    REQUIRE(s2.optionals == std::vector<std::string>{"NH:i:1"});
+  }
 }
\ No newline at end of file
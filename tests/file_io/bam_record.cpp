@@ -0,0 +1,81 @@
+#include <biovoltron/file_io/bam_record.hpp>
+#include <catch.hpp>
+
+using namespace biovoltron;
+using namespace std::string_literals;
+
+TEST_CASE("BamRecord - Packs variable-length fields in bam1_t layout", "[BamRecord]") {
+  auto record = BamRecord{};
+
+  SECTION("Read name is NUL-padded to a 4-byte boundary") {
+    record.append_qname("read1");
+    CHECK(record.l_qname == 8);
+    CHECK(record.l_extranul == 2);
+    CHECK(record.get_qname() == "read1");
+
+    record.clear();
+    record.append_qname("abc");
+    CHECK(record.l_qname == 4);
+    CHECK(record.l_extranul == 0);
+  }
+
+  SECTION("Cigar, sequence and qualities round trip") {
+    record.append_qname("r");
+    CHECK(record.append_cigar("2S3M1D2M") == 6);
+    record.append_seq("ACGTNAC"s);
+    record.append_qual("ABCDEFG");
+    CHECK(record.n_cigar == 4);
+    CHECK(record.l_qseq == 7);
+    CHECK(record.get_cigar() == "2S3M1D2M"s);
+    CHECK(record.get_seq() == "ACGTNAC");
+    CHECK(record.get_qual() == "ABCDEFG");
+    CHECK(record.get_aux().empty());
+  }
+
+  SECTION("Encoded sequence and reversed qualities") {
+    record.append_qname("r");
+    record.append_cigar("*");
+    record.append_seq(Codec::to_istring("TTGCA"));
+    record.append_qual("ABCDE", true);
+    CHECK(record.n_cigar == 0);
+    CHECK(record.get_seq() == "TTGCA");
+    CHECK(record.get_qual() == "EDCBA");
+  }
+
+  SECTION("Missing qualities") {
+    record.append_qname("r");
+    record.append_seq("ACG"s);
+    record.append_qual("*");
+    CHECK(record.get_qual() == "*");
+  }
+
+  SECTION("Aux fields use the smallest integer type") {
+    record.append_qname("r");
+    record.append_aux("AS", 60);
+    record.append_aux("XS", -3);
+    record.append_aux("NM", 70000);
+    record.append_aux("RG", "1");
+    const auto aux = record.get_aux();
+    REQUIRE(aux.size() == 4 + 4 + 7 + 5);
+    CHECK(aux[2] == 'C');
+    CHECK(aux[3] == 60);
+    CHECK(aux[6] == 'c');
+    CHECK(static_cast<std::int8_t>(aux[7]) == -3);
+    CHECK(aux[10] == 'I');
+    CHECK(aux[17] == 'Z');
+    CHECK(aux[18] == '1');
+    CHECK(aux[19] == '\0');
+  }
+
+  SECTION("clear() resets fields and keeps capacity") {
+    record.tid = 2;
+    record.append_qname("read1");
+    record.append_seq("ACGT"s);
+    const auto capacity = record.data.capacity();
+    record.clear();
+    CHECK(record.tid == -1);
+    CHECK(record.l_qseq == 0);
+    CHECK(record.data.empty());
+    CHECK(record.data.capacity() == capacity);
+  }
+}
@@ -190,5 +190,12 @@ TEST_CASE("MathUtils::Utilities - Performs various math calculations", "[MathUti
         == Approx(log10(0.2)).margin(1e-6));
       REQUIRE(MathUtils::approximate_log10_sum_log10(log10(1e-100), log10(1.0))
         == Approx(log10(1.0)).margin(1e-12));
+
+      const auto a = std::vector{log10(0.1), log10(1e-100), -3.0, -1.25, 0.0};
+      const auto b = std::vector{log10(0.1), log10(1.0), -3.00005, -9.25, -8.0};
+      auto result = std::vector(a.size(), 0.0);
+      MathUtils::approximate_log10_sum_log10(a, b, result);
+      for (auto i = 0; i < a.size(); i++)
+        REQUIRE(result[i] == MathUtils::approximate_log10_sum_log10(a[i], b[i]));
     }
 }
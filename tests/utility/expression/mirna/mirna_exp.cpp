@@ -150,6 +150,11 @@ TEST_CASE("MirExp::Construction - Constructs MirExp objects", "[MirExp]") {
     CHECK(mir_2.tails[2].lens[8].value == 0.5); // G tail, len 8 (10 - 2 tail len)
     CHECK(mir_2.tails[2].lens[10].value == 0); // G tail, len 10
     CHECK(mir_2.tails[0].lens[8].value == 0); // A tail, len 8
+
+    // A collapsed sequence counts once per read.
+    auto mir_3 = mirna::MirExp::init_from_alignment(aln2, 6);
+    CHECK(mir_3.value == 3.0);
+    CHECK(mir_3.tails[2].lens[8].value == 3.0);
   }
 }
 
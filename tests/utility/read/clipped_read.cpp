@@ -0,0 +1,158 @@
+#include <biovoltron/utility/read/read_clipper.hpp>
+#include <biovoltron/utility/read/read_filter.hpp>
+#include <catch.hpp>
+#include <chrono>
+#include <iostream>
+#include <random>
+
+using namespace biovoltron;
+
+namespace {
+
+// Reads of a deep window, with soft clips on either end, both strands and
+// a share of them failing the HaplotypeCaller filters.
+auto
+deep_window_reads(std::size_t count, std::uint32_t window_begin) {
+  auto rng = std::mt19937{2024};
+  const auto uniform = [&](std::uint32_t n) { return rng() % n; };
+  auto reads = std::vector<SamRecord<>>(count);
+  for (auto& read : reads) {
+    const auto front = uniform(3) == 0 ? 1 + uniform(30) : 0;
+    const auto back = uniform(3) == 0 ? 1 + uniform(30) : 0;
+    const auto match = 20 + uniform(130);
+    read.qname = "read" + std::to_string(uniform(1000000));
+    read.rname = "chr1";
+    read.pos = window_begin + uniform(400);
+    read.mapq = uniform(10) == 0 ? 10 : 60;
+    read.flag = (uniform(2) ? SamUtil::READ_REVERSE_STRAND : 0)
+                | (uniform(20) == 0 ? SamUtil::DUPLICATE_READ : 0);
+    read.rnext = uniform(20) == 0 ? "chr2" : "=";
+    read.cigar = Cigar{};
+    if (front)
+      read.cigar.emplace_back(front, 'S');
+    read.cigar.emplace_back(match, 'M');
+    if (back)
+      read.cigar.emplace_back(back, 'S');
+    read.seq.resize(front + match + back);
+    read.qual.resize(read.seq.size());
+    for (auto i = 0; i < read.seq.size(); i++) {
+      read.seq[i] = "ACGT"[uniform(4)];
+      read.qual[i] = '!' + uniform(41);
+    }
+  }
+  return reads;
+}
+
+constexpr auto read_filter = CompositeReadFilter{
+  MappingQualityReadFilter{}, DuplicateReadFilter{},
+  SecondaryAlignmentReadFilter{}, MateOnSameContigReadFilter{}};
+
+// Filtering and clipping on copies of the reads, one pass per step.
+auto
+clip_copies(const std::vector<SamRecord<>>& records, const Interval& interval) {
+  auto reads = records;
+  std::erase_if(reads, MappingQualityReadFilter{});
+  std::erase_if(reads, DuplicateReadFilter{});
+  std::erase_if(reads, SecondaryAlignmentReadFilter{});
+  std::erase_if(reads, MateOnSameContigReadFilter{});
+  for (auto& read : reads) ReadClipper::revert_soft_clipped_bases(read);
+  for (auto& read : reads) ReadClipper::hard_clip_to_interval(read, interval);
+  std::erase_if(reads, MinimumLengthReadFilter{});
+  return reads;
+}
+
+// The same in one pass over views, copying only the clipped survivors.
+auto
+clip_views(const std::vector<SamRecord<>>& records, const Interval& interval) {
+  auto reads = std::vector<SamRecord<>>{};
+  for (const auto& record : records) {
+    if (read_filter(record))
+      continue;
+    auto read = ClippedRead<>{&record};
+    ReadClipper::revert_soft_clipped_bases(read);
+    ReadClipper::hard_clip_to_interval(read, interval);
+    if (!MinimumLengthReadFilter{}(read))
+      reads.push_back(read.materialize());
+  }
+  return reads;
+}
+
+}  // namespace
+
+TEST_CASE("ClippedRead - Clips as ReadClipper does on records", "[ClippedRead]") {
+  SECTION("Soft clips") {
+    auto record = SamRecord<>{};
+    record.rname = "chr1";
+    record.seq = "ACGTACGTACGTACG";
+    record.qual = "ABCDEFGHIJKLMNO";
+    record.pos = 11;
+    record.cigar = Cigar{"5S5M5S"};
+
+    auto read = ClippedRead<>{&record};
+    ReadClipper::revert_soft_clipped_bases(read);
+    CHECK(read.begin() == 5);
+    CHECK(read.end() == 15);
+    CHECK(read.size() == 10);
+    ReadClipper::hard_clip_to_interval(read, Interval{"chr1", 7, 20});
+    CHECK(read.size() == 8);
+
+    auto clipped = record;
+    ReadClipper::revert_soft_clipped_bases(clipped);
+    ReadClipper::hard_clip_to_interval(clipped, Interval{"chr1", 7, 20});
+    CHECK(read.materialize() == clipped);
+    CHECK(clipped.seq == "GTACGTAC");
+    CHECK(std::string(clipped.cigar) == "5M5M5S");
+
+    record.flag = SamUtil::READ_REVERSE_STRAND;
+    read = ClippedRead<>{&record};
+    clipped = record;
+    ReadClipper::revert_soft_clipped_bases(read);
+    ReadClipper::revert_soft_clipped_bases(clipped);
+    CHECK(read.materialize() == clipped);
+    CHECK(std::string(clipped.cigar) == "5S5M5M");
+  }
+
+  SECTION("Lone soft clips") {
+    auto record = SamRecord<>{};
+    record.rname = "chr1";
+    record.seq = "ACGTACGTAC";
+    record.qual = "ABCDEFGHIJ";
+    record.pos = 21;
+    record.cigar = Cigar{"10S"};
+    for (const auto reverse : {false, true}) {
+      record.flag = reverse ? SamUtil::READ_REVERSE_STRAND : 0;
+      auto read = ClippedRead<>{&record};
+      auto clipped = record;
+      ReadClipper::revert_soft_clipped_bases(read);
+      ReadClipper::revert_soft_clipped_bases(clipped);
+      CHECK(read.materialize() == clipped);
+    }
+  }
+
+  SECTION("Deep window") {
+    const auto interval = Interval{"chr1", 1000, 1300};
+    const auto records = deep_window_reads(500, interval.begin - 100);
+    const auto views = clip_views(records, interval);
+    REQUIRE(!views.empty());
+    CHECK(views == clip_copies(records, interval));
+  }
+}
+
+TEST_CASE("ClippedRead - Benchmark", "[.][benchmark]") {
+  const auto interval = Interval{"chr1", 1000, 1300};
+  const auto records = deep_window_reads(20000, interval.begin - 100);
+
+  auto start = std::chrono::steady_clock::now();
+  const auto copies = clip_copies(records, interval);
+  const auto copy_time = std::chrono::duration<double, std::milli>(
+    std::chrono::steady_clock::now() - start);
+
+  start = std::chrono::steady_clock::now();
+  const auto views = clip_views(records, interval);
+  const auto view_time = std::chrono::duration<double, std::milli>(
+    std::chrono::steady_clock::now() - start);
+
+  std::cout << records.size() << " reads: copies " << copy_time.count()
+            << " ms, views " << view_time.count() << " ms\n";
+  CHECK(views == copies);
+}
@@ -60,4 +60,26 @@ TEST_CASE("ReadFilter::Filtering - Filters reads based on various criteria", "[R
     different_contig.rnext = "chr2";
     REQUIRE(filter(different_contig) == true);
   }
+  SECTION("Composite Read Filter") {
+    constexpr auto filter = CompositeReadFilter{
+      MappingQualityReadFilter{}, DuplicateReadFilter{},
+      MateOnSameContigReadFilter{}};
+
+    SamRecord<> good_read;
+    good_read.mapq = 30;
+    good_read.rnext = "=";
+    REQUIRE(filter(good_read) == false);
+
+    auto low_quality = good_read;
+    low_quality.mapq = 10;
+    REQUIRE(filter(low_quality) == true);
+
+    auto duplicate = good_read;
+    duplicate.flag = SamUtil::DUPLICATE_READ;
+    REQUIRE(filter(duplicate) == true);
+
+    auto different_contig = good_read;
+    different_contig.rnext = "chr2";
+    REQUIRE(filter(different_contig) == true);
+  }
 }
\ No newline at end of file
@@ -0,0 +1,83 @@
+#include <biovoltron/utility/threadpool/parallel_for.hpp>
+#include <catch.hpp>
+#include <numeric>
+#include <stdexcept>
+
+using namespace biovoltron;
+
+TEST_CASE("parallel_for - Runs every index once", "[parallel_for]") {
+  SECTION("Chunks of indexes") {
+    for (const auto& [n, threads, chunk_size] :
+         {std::tuple{1000, 4, 16}, {1000, 64, 1}, {10, 8, 3}, {7, 1, 100}}) {
+      auto runs = std::vector<std::atomic<int>>(n);
+      parallel_for(n, threads, chunk_size, [&](auto i) { runs[i]++; });
+      CHECK(std::ranges::all_of(runs, [](const auto& run) { return run == 1; }));
+    }
+  }
+
+  SECTION("No index") {
+    auto run_cnt = 0;
+    parallel_for(0, 4, 16, [&](auto) { run_cnt++; });
+    parallel_for(0, 4, 0, [&](auto) { run_cnt++; });
+    CHECK(run_cnt == 0);
+  }
+
+  SECTION("Chunk size 0 is taken as 1") {
+    auto runs = std::vector<std::atomic<int>>(100);
+    parallel_for(runs.size(), 4, 0, [&](auto i) { runs[i]++; });
+    CHECK(std::ranges::all_of(runs, [](const auto& run) { return run == 1; }));
+  }
+
+  SECTION("A single chunk runs on the calling thread") {
+    const auto caller = std::this_thread::get_id();
+    auto other_thread = false;
+    parallel_for(3, 8, 16, [&](auto) {
+      other_thread |= std::this_thread::get_id() != caller;
+    });
+    CHECK(!other_thread);
+  }
+
+  SECTION("Exceptions reach the caller once the workers are done") {
+    for (const auto thrower : {0u, 1u, 999u}) {
+      auto runs = std::atomic<int>{};
+      CHECK_THROWS_AS(parallel_for(1000, 4, 1, [&](auto i) {
+        runs++;
+        if (i == thrower)
+          throw std::out_of_range{"index"};
+      }), std::out_of_range);
+      CHECK(runs <= 1000);
+    }
+  }
+}
+
+TEST_CASE("ParallelForPool - Reuses its workers across loops", "[parallel_for]") {
+  auto pool = ParallelForPool{4};
+  REQUIRE(pool.size() == 4);
+
+  auto owners = std::vector<std::thread::id>(pool.size());
+  auto same_owner = std::atomic<bool>{true};
+  for (auto loop = 0; loop < 50; loop++) {
+    auto runs = std::vector<std::atomic<int>>(200);
+    pool.run(runs.size(), 3, [&](auto i, auto worker) {
+      runs[i]++;
+      if (loop == 0 && i < 3 * pool.size())
+        std::this_thread::yield();
+      if (owners[worker] == std::thread::id{})
+        owners[worker] = std::this_thread::get_id();
+      else if (owners[worker] != std::this_thread::get_id())
+        same_owner = false;
+    });
+    CHECK(std::ranges::all_of(runs, [](const auto& run) { return run == 1; }));
+  }
+  CHECK(same_owner);
+
+  auto after_error = 0;
+  CHECK_THROWS(pool.run(100, 1, [](auto i) {
+    if (i == 50) throw std::runtime_error{"stop"};
+  }));
+  pool.run(10, 1, [&](auto, auto worker) {
+    if (worker == 0) after_error++;
+  });
+  pool.run(0, 1, [&](auto) { after_error = -1; });
+  CHECK(after_error >= 0);
+}